@@ -0,0 +1,249 @@
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "DynamicObject.hpp"
+#include "FrameContext.hpp"
+#include "HeadlessContext.hpp"
+#include "Matrix.hpp"
+#include "MeshGenerator.hpp"
+#include "SolidShapeIndex.hpp"
+#include "Transform.hpp"
+
+// ---------------------------------------------------------------- //
+//	Prototype declaration
+// ---------------------------------------------------------------- //
+HeadlessContext* getContext();
+GLuint loadBenchmarkProgram(const char* vert, const char* frag);
+
+// ---------------------------------------------------------------- //
+//	Object upload / SolidShapeIndex::draw
+// ---------------------------------------------------------------- //
+
+// 分割数ごとの頂点バッファとインデックスバッファの転送
+//   range(0): 経度方向の分割数（緯度方向はその半分）
+static void BM_ObjectUpload(benchmark::State& state)
+{
+	if (getContext() == nullptr) {
+		state.SkipWithError("Headless GL context is not available.");
+		return;
+	}
+
+	const int slices(static_cast<int>(state.range(0)));
+	std::vector<Object::Vertex> vertex;
+	std::vector<GLuint> index;
+	generateSphere(slices, slices / 2, vertex, index);
+	const GLsizei vertexCount(static_cast<GLsizei>(vertex.size()));
+	const GLsizei indexCount(static_cast<GLsizei>(index.size()));
+
+	for (auto _ : state) {
+		// 作成と破棄を含めて GPU への転送が終わるまでを測る
+		const Object object(3, vertexCount, vertex.data(), indexCount, index.data());
+		glFinish();
+	}
+	state.SetBytesProcessed(state.iterations() * (vertexCount * sizeof(Object::Vertex) + indexCount * sizeof(GLuint)));
+}
+BENCHMARK(BM_ObjectUpload)->Arg(16)->Arg(64)->Arg(256)->UseRealTime();
+
+// 同じ図形を繰り返し描く命令の発行と実行
+//   range(0): 経度方向の分割数, range(1): 1回に描く数
+static void BM_SolidShapeIndexDraw(benchmark::State& state)
+{
+	if (getContext() == nullptr) {
+		state.SkipWithError("Headless GL context is not available.");
+		return;
+	}
+
+	const GLuint program(loadBenchmarkProgram(SHADER_DIR "/point.vert", SHADER_DIR "/point.frag"));
+	if (program == 0) {
+		state.SkipWithError("Can't load point.vert / point.frag.");
+		return;
+	}
+	glUseProgram(program);
+	glUniformBlockBinding(program, glGetUniformBlockIndex(program, "Material"), 0);
+	glUniformBlockBinding(program, glGetUniformBlockIndex(program, "Transform"), 1);
+
+	// 変換行列とマテリアルは固定
+	const Matrix view(Matrix::lookat(3.0f, 4.0f, 5.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f));
+	const Matrix projection(Matrix::perspective(1.0f, 1.333f, 1.0f, 10.0f));
+	Transform transform;
+	std::copy(view.data(), view.data() + 16, transform.modelView.begin());
+	std::copy(projection.data(), projection.data() + 16, transform.projection.begin());
+	GLfloat normalMatrix[9];
+	view.getNormalMatrix(normalMatrix);
+	for (int j = 0; j < 3; ++j) {
+		std::copy(normalMatrix + j * 3, normalMatrix + j * 3 + 3, transform.normalMatrix.begin() + j * 4);
+	}
+	static constexpr GLfloat material[] = { 0.6f, 0.6f, 0.2f, 0.0f, 0.6f, 0.6f, 0.2f, 0.0f, 0.3f, 0.3f, 0.3f, 30.0f };
+
+	ResourceManager manager;
+	const BufferHandle transformBuffer(manager.createBuffer(GL_UNIFORM_BUFFER, sizeof transform, &transform, GL_STATIC_DRAW));
+	const BufferHandle materialBuffer(manager.createBuffer(GL_UNIFORM_BUFFER, sizeof material, material, GL_STATIC_DRAW));
+	glBindBufferBase(GL_UNIFORM_BUFFER, 1, manager.getBuffer(transformBuffer)->name);
+	glBindBufferBase(GL_UNIFORM_BUFFER, 0, manager.getBuffer(materialBuffer)->name);
+
+	const int slices(static_cast<int>(state.range(0)));
+	const int batch(static_cast<int>(state.range(1)));
+	std::vector<Object::Vertex> vertex;
+	std::vector<GLuint> index;
+	generateSphere(slices, slices / 2, vertex, index);
+	const std::unique_ptr<const Shape> shape(new SolidShapeIndex(manager, 3,
+		static_cast<GLsizei>(vertex.size()), vertex.data(), static_cast<GLsizei>(index.size()), index.data()));
+
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_CULL_FACE);
+	for (auto _ : state) {
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		for (int i = 0; i < batch; ++i) shape->draw();
+		glFinish();
+	}
+	state.SetItemsProcessed(state.iterations() * batch);
+	state.counters["triangles"] = benchmark::Counter(static_cast<double>(index.size() / 3) * batch * state.iterations(), benchmark::Counter::kIsRate);
+
+	manager.release(transformBuffer);
+	manager.release(materialBuffer);
+	glUseProgram(0);
+	glDeleteProgram(program);
+}
+BENCHMARK(BM_SolidShapeIndexDraw)->Args({ 16, 100 })->Args({ 64, 100 })->Args({ 256, 10 })->UseRealTime();
+
+// ---------------------------------------------------------------- //
+//	DynamicObject streaming
+// ---------------------------------------------------------------- //
+
+// 毎フレーム頂点を書き換えて描く（先行するフレームは FramePipeline で2フレームまでにする）
+//   range(0): 経度方向の分割数
+//   range(1): 0 = map() でリングの次の領域に書き込む, 1 = update() で前半の頂点だけ書き換える,
+//             2 = orphan() で記憶領域ごと書き換える
+static void BM_DynamicObjectStream(benchmark::State& state)
+{
+	if (getContext() == nullptr) {
+		state.SkipWithError("Headless GL context is not available.");
+		return;
+	}
+
+	// 頂点の位置だけで描く
+	const GLuint program(loadBenchmarkProgram(SHADER_DIR "/shadow.vert", SHADER_DIR "/shadow.frag"));
+	if (program == 0) {
+		state.SkipWithError("Can't load shadow.vert / shadow.frag.");
+		return;
+	}
+	glUseProgram(program);
+	const Matrix matrix(Matrix::perspective(1.0f, 1.333f, 1.0f, 10.0f)
+		* Matrix::lookat(3.0f, 4.0f, 5.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f));
+	glUniformMatrix4fv(glGetUniformLocation(program, "lightMatrix"), 1, GL_FALSE, matrix.data());
+
+	const int slices(static_cast<int>(state.range(0)));
+	const int mode(static_cast<int>(state.range(1)));
+	std::vector<Object::Vertex> vertex;
+	std::vector<GLuint> index;
+	generateSphere(slices, slices / 2, vertex, index);
+	const GLsizei vertexCount(static_cast<GLsizei>(vertex.size()));
+
+	FramePipeline frames(2);
+	DynamicObject object(3, vertexCount, vertex.data(), static_cast<GLsizei>(index.size()), index.data(), frames.getCount());
+	std::vector<Object::Vertex> deformed(vertex);
+
+	// 1フレームに送る頂点数
+	const GLsizei streamed(mode == 1 ? vertexCount / 2 : vertexCount);
+
+	glEnable(GL_DEPTH_TEST);
+	int frame(0);
+	for (auto _ : state) {
+		frames.begin();
+
+		// 頂点を少しずつ膨らませる
+		const GLfloat d(1.0f + 0.001f * (++frame % 100));
+		Object::Vertex* const dst(mode == 0 ? object.map() : deformed.data());
+		if (dst == nullptr) {
+			state.SkipWithError("Can't map the vertex buffer.");
+			break;
+		}
+		for (GLsizei i = 0; i < streamed; ++i) {
+			const Object::Vertex& v(vertex[i]);
+			dst[i] = { v.position[0] * d, v.position[1] * d, v.position[2] * d, v.normal[0], v.normal[1], v.normal[2] };
+		}
+		if (mode == 0) {
+			// マップした領域は全体を書き込む
+			std::copy(vertex.begin() + streamed, vertex.end(), dst + streamed);
+			object.unmap();
+		}
+		else if (mode == 1) {
+			object.update(0, streamed, deformed.data());
+		}
+		else {
+			object.orphan(deformed.data());
+		}
+
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		object.draw();
+		frames.end();
+	}
+	glFinish();
+	state.SetBytesProcessed(state.iterations() * streamed * static_cast<std::int64_t>(sizeof(Object::Vertex)));
+
+	glUseProgram(0);
+	glDeleteProgram(program);
+}
+BENCHMARK(BM_DynamicObjectStream)
+	->Args({ 64, 0 })->Args({ 64, 1 })->Args({ 64, 2 })
+	->Args({ 256, 0 })->Args({ 256, 1 })->Args({ 256, 2 })
+	->UseRealTime();
+
+/// <summary>
+/// ベンチマーク全体で共有するヘッドレスの GL コンテキストを取り出す
+/// </summary>
+/// <returns>作成できなければ nullptr</returns>
+HeadlessContext* getContext()
+{
+	// フラグメントの処理ではなく命令の発行を測るので描画先は小さくする
+	static HeadlessContext context(64, 64);
+	return context.isValid() ? &context : nullptr;
+}
+
+/// <summary>
+/// シェーダのソースファイルを読み込んでプログラムオブジェクトを作成する
+/// </summary>
+/// <param name="vert">頂点シェーダのファイルパス</param>
+/// <param name="frag">フラグメントシェーダのファイルパス</param>
+/// <returns>作成できなければ 0</returns>
+GLuint loadBenchmarkProgram(const char* vert, const char* frag)
+{
+	const char* const names[] = { vert, frag };
+	const GLenum types[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+
+	const GLuint program(glCreateProgram());
+	for (int i = 0; i < 2; ++i) {
+		std::ifstream file(names[i], std::ios::binary);
+		if (file.fail()) {
+			std::cerr << "Error: Can't open source file: " << names[i] << std::endl;
+			glDeleteProgram(program);
+			return 0;
+		}
+		const std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		const GLchar* const src(source.c_str());
+
+		const GLuint shader(glCreateShader(types[i]));
+		glShaderSource(shader, 1, &src, nullptr);
+		glCompileShader(shader);
+		glAttachShader(program, shader);
+		glDeleteShader(shader);
+	}
+
+	glBindAttribLocation(program, 0, "position");
+	glBindAttribLocation(program, 1, "normal");
+	glBindFragDataLocation(program, 0, "fragment");
+	glLinkProgram(program);
+
+	GLint status;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (status == GL_FALSE) {
+		std::cerr << "Error: Can't link benchmark program." << std::endl;
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/glew.h>
+#include <iostream>
+
+//
+// ウィンドウを持たない GL 3.3 Core Profile のコンテキスト
+//   Mesa の surfaceless プラットフォームで作り、描画はフレームバッファオブジェクトに行う
+//
+class HeadlessContext {
+private:
+	EGLDisplay _display;
+	EGLContext _context;
+
+	// 描画先のフレームバッファオブジェクトとレンダーバッファ
+	GLuint _fbo, _color, _depth;
+
+	// UnCopiable
+	HeadlessContext(const HeadlessContext& o) = delete;
+	HeadlessContext& operator=(const HeadlessContext& rhs) = delete;
+
+public:
+	HeadlessContext(GLsizei width = 640, GLsizei height = 480)
+		: _display(eglGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr))
+		, _context(EGL_NO_CONTEXT)
+		, _fbo(0)
+		, _color(0)
+		, _depth(0)
+	{
+		if (_display == EGL_NO_DISPLAY || eglInitialize(_display, nullptr, nullptr) == EGL_FALSE) {
+			std::cerr << "Error: Can't initialize EGL." << std::endl;
+			_display = EGL_NO_DISPLAY;
+			return;
+		}
+
+		eglBindAPI(EGL_OPENGL_API);
+		const EGLint attributes[] = {
+			EGL_CONTEXT_MAJOR_VERSION, 3,
+			EGL_CONTEXT_MINOR_VERSION, 3,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+		_context = eglCreateContext(_display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes);
+		if (_context == EGL_NO_CONTEXT || eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, _context) == EGL_FALSE) {
+			std::cerr << "Error: Can't create headless GL context." << std::endl;
+			_context = EGL_NO_CONTEXT;
+			return;
+		}
+
+		glGenRenderbuffers(1, &_color);
+		glBindRenderbuffer(GL_RENDERBUFFER, _color);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glGenRenderbuffers(1, &_depth);
+		glBindRenderbuffer(GL_RENDERBUFFER, _depth);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+		glGenFramebuffers(1, &_fbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _color);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depth);
+		glViewport(0, 0, width, height);
+	}
+
+	virtual ~HeadlessContext() {
+		if (_context != EGL_NO_CONTEXT) {
+			glDeleteFramebuffers(1, &_fbo);
+			glDeleteRenderbuffers(1, &_depth);
+			glDeleteRenderbuffers(1, &_color);
+			eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			eglDestroyContext(_display, _context);
+		}
+		if (_display != EGL_NO_DISPLAY) eglTerminate(_display);
+	}
+
+	bool isValid() const { return _context != EGL_NO_CONTEXT; }
+};
@@ -0,0 +1,128 @@
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "Matrix.hpp"
+#include "Vector.hpp"
+#include "TransformStore.hpp"
+
+// ---------------------------------------------------------------- //
+//	Matrix / Vector
+// ---------------------------------------------------------------- //
+static void BM_MatrixMultiply(benchmark::State& state)
+{
+	Matrix a(Matrix::rotate(0.5f, 1.0f, 2.0f, 3.0f) * Matrix::translate(1.0f, 2.0f, 3.0f));
+	Matrix b(Matrix::lookat(3.0f, 4.0f, 5.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f));
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(a);
+		benchmark::DoNotOptimize(b);
+		Matrix c(a * b);
+		benchmark::DoNotOptimize(c);
+	}
+}
+BENCHMARK(BM_MatrixMultiply);
+
+static void BM_NormalMatrix(benchmark::State& state)
+{
+	Matrix m(Matrix::lookat(3.0f, 4.0f, 5.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f) * Matrix::rotate(0.5f, 0.0f, 1.0f, 0.0f));
+	GLfloat n[9];
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(m);
+		m.getNormalMatrix(n);
+		benchmark::DoNotOptimize(n);
+	}
+}
+BENCHMARK(BM_NormalMatrix);
+
+static void BM_Lookat(benchmark::State& state)
+{
+	GLfloat e[] = { 3.0f, 4.0f, 5.0f };
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(e);
+		Matrix m(Matrix::lookat(e[0], e[1], e[2], 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f));
+		benchmark::DoNotOptimize(m);
+	}
+}
+BENCHMARK(BM_Lookat);
+
+static void BM_Perspective(benchmark::State& state)
+{
+	GLfloat fovy(1.0f), aspect(1.333f);
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(fovy);
+		benchmark::DoNotOptimize(aspect);
+		Matrix m(Matrix::perspective(fovy, aspect, 1.0f, 10.0f));
+		benchmark::DoNotOptimize(m);
+	}
+}
+BENCHMARK(BM_Perspective);
+
+static void BM_Rotate(benchmark::State& state)
+{
+	GLfloat a(0.5f);
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(a);
+		Matrix m(Matrix::rotate(a, 0.0f, 1.0f, 0.0f));
+		benchmark::DoNotOptimize(m);
+	}
+}
+BENCHMARK(BM_Rotate);
+
+static void BM_VectorTransform(benchmark::State& state)
+{
+	Matrix m(Matrix::lookat(3.0f, 4.0f, 5.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f));
+	Vector v = { 0.0f, 0.0f, 5.0f, 1.0f };
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(m);
+		benchmark::DoNotOptimize(v);
+		Vector t(m * v);
+		benchmark::DoNotOptimize(t);
+	}
+}
+BENCHMARK(BM_VectorTransform);
+
+// ---------------------------------------------------------------- //
+//	TransformStore
+// ---------------------------------------------------------------- //
+
+// インスタンス数とスレッド数ごとのモデルビュー変換行列と法線変換行列の合成
+static void BM_TransformStoreCompose(benchmark::State& state)
+{
+	const std::uint32_t count(static_cast<std::uint32_t>(state.range(0)));
+	TransformStore store(count);
+	for (std::uint32_t i = 0; i < count; ++i) {
+		const std::uint32_t k(store.create());
+		store.setPosition(k, static_cast<GLfloat>(i % 97), static_cast<GLfloat>(i % 13), static_cast<GLfloat>(i % 31));
+		store.setAxisAngle(k, 0.01f * i, 0.0f, 1.0f, 0.0f);
+	}
+
+	const int threads(static_cast<int>(state.range(1)));
+	const Matrix view(Matrix::lookat(3.0f, 4.0f, 5.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f));
+	std::vector<GLfloat> model(static_cast<std::size_t>(count) * 16), normal(static_cast<std::size_t>(count) * 12);
+	for (auto _ : state) {
+		store.compose(view, model.data(), normal.data(), threads);
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_TransformStoreCompose)
+	->Args({ 1024, 1 })->Args({ 65536, 1 })->Args({ 262144, 1 })
+	->Args({ 4099, 4 })->Args({ 65536, 4 })->Args({ 262144, 4 })
+	->UseRealTime();
+
+// 同じ数の Matrix を translate * rotate で作る場合
+static void BM_MatrixCompose(benchmark::State& state)
+{
+	const std::uint32_t count(static_cast<std::uint32_t>(state.range(0)));
+	const Matrix view(Matrix::lookat(3.0f, 4.0f, 5.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f));
+	std::vector<Matrix> model(count);
+	std::vector<GLfloat> normal(static_cast<std::size_t>(count) * 9);
+	for (auto _ : state) {
+		for (std::uint32_t i = 0; i < count; ++i) {
+			model[i] = view * Matrix::translate(static_cast<GLfloat>(i % 97), static_cast<GLfloat>(i % 13), static_cast<GLfloat>(i % 31))
+				* Matrix::rotate(0.01f * i, 0.0f, 1.0f, 0.0f);
+			model[i].getNormalMatrix(&normal[static_cast<std::size_t>(i) * 9]);
+		}
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_MatrixCompose)->Arg(1024)->Arg(65536);
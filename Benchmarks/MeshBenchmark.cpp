@@ -0,0 +1,44 @@
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "MeshGenerator.hpp"
+
+// ---------------------------------------------------------------- //
+//	Sphere generation
+// ---------------------------------------------------------------- //
+
+// 分割数ごとの実行時の球の生成
+//   range(0): 経度方向の分割数（緯度方向はその半分）, range(1): スレッド数
+static void BM_GenerateSphere(benchmark::State& state)
+{
+	const int slices(static_cast<int>(state.range(0)));
+	const int stacks(slices / 2);
+	const int threads(static_cast<int>(state.range(1)));
+
+	std::vector<Object::Vertex> vertex;
+	std::vector<GLuint> index;
+	for (auto _ : state) {
+		generateSphere(slices, stacks, vertex, index, threads);
+		benchmark::DoNotOptimize(vertex.data());
+		benchmark::DoNotOptimize(index.data());
+	}
+	state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(slices + 1) * (stacks + 1));
+}
+BENCHMARK(BM_GenerateSphere)
+	->Args({ 16, 1 })->Args({ 64, 1 })->Args({ 256, 1 })->Args({ 1024, 1 })
+	->Args({ 1024, 4 })
+	->UseRealTime();
+
+// コンパイル時に作った球の頂点を読み出すだけの場合（実行時の生成との比較用）
+static void BM_SphereMeshCopy(benchmark::State& state)
+{
+	using Sphere = SphereMesh<64, 32>;
+	std::vector<Object::Vertex> vertex(Sphere::vertexCount);
+	std::vector<GLuint> index(Sphere::indexCount);
+	for (auto _ : state) {
+		std::copy(Sphere::vertex.begin(), Sphere::vertex.end(), vertex.begin());
+		std::copy(Sphere::index.begin(), Sphere::index.end(), index.begin());
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * Sphere::vertexCount);
+}
+BENCHMARK(BM_SphereMeshCopy);
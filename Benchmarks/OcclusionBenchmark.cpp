@@ -0,0 +1,61 @@
+#include <benchmark/benchmark.h>
+#include "Matrix.hpp"
+#include "MeshGenerator.hpp"
+#include "OcclusionCuller.hpp"
+
+// ---------------------------------------------------------------- //
+//	OcclusionCuller
+// ---------------------------------------------------------------- //
+
+// 遮蔽物の球を並べた場面（球は手前から奥へ少しずつずらす）
+static void addSpheres(OcclusionCuller& culler, const Matrix& projection, int count)
+{
+	using Sphere = SphereMesh<32, 16>;
+	for (int i = 0; i < count; ++i) {
+		const GLfloat x(static_cast<GLfloat>(i % 8) - 3.5f), y(static_cast<GLfloat>(i / 8 % 4) - 1.5f);
+		culler.addOccluder(projection * Matrix::translate(x, y, -6.0f - 0.25f * (i / 32)),
+			Sphere::vertexCount, Sphere::vertex.data(), Sphere::indexCount, Sphere::index.data());
+	}
+}
+
+// 遮蔽物の変換・振り分け・描画・Hi-Z の作成
+//   range(0): 遮蔽物の球の数, range(1): スレッド数
+static void BM_OcclusionRasterize(benchmark::State& state)
+{
+	const int count(static_cast<int>(state.range(0)));
+	OcclusionCuller culler(256, 128, static_cast<int>(state.range(1)));
+	const Matrix projection(Matrix::perspective(1.0f, 2.0f, 1.0f, 20.0f));
+
+	for (auto _ : state) {
+		culler.clear();
+		addSpheres(culler, projection, count);
+		culler.rasterize();
+		benchmark::DoNotOptimize(culler.getDepth());
+	}
+	state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(culler.getTriangleCount()));
+}
+BENCHMARK(BM_OcclusionRasterize)->Args({ 4, 1 })->Args({ 32, 1 })->Args({ 32, 4 })->UseRealTime();
+
+// 境界ボックスが隠れているかの判定
+static void BM_OcclusionIsVisible(benchmark::State& state)
+{
+	OcclusionCuller culler(256, 128);
+	const Matrix projection(Matrix::perspective(1.0f, 2.0f, 1.0f, 20.0f));
+	culler.clear();
+	addSpheres(culler, projection, 32);
+	culler.rasterize();
+
+	static constexpr GLfloat boxMin[] = { -0.5f, -0.5f, -0.5f };
+	static constexpr GLfloat boxMax[] = { 0.5f, 0.5f, 0.5f };
+	int visible(0), n(0);
+	for (auto _ : state) {
+		// 遮蔽物の奥と手前を交互に調べる
+		const GLfloat z((n & 1) ? -9.0f : -3.0f);
+		const Matrix m(projection * Matrix::translate(static_cast<GLfloat>(n % 7) - 3.0f, 0.0f, z));
+		visible += culler.isVisible(m, boxMin, boxMax) ? 1 : 0;
+		++n;
+	}
+	benchmark::DoNotOptimize(visible);
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_OcclusionIsVisible);
@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+"""Compare a Google Benchmark JSON result against a stored baseline.
+
+    python3 compare_benchmarks.py baseline.json result.json [--threshold 10] [--metric real_time]
+
+Benchmarks that got slower than the baseline by more than the threshold
+(percent) are reported as regressions, and the script exits with status 1.
+When the results contain repetitions, the median aggregate is compared.
+A warning is printed when either file was recorded with a debug build of
+the Google Benchmark library, since those timings are not comparable.
+The baseline is only meaningful on the machine that recorded it, so none
+is committed. Record one with --benchmark_out (see Benchmarks/CMakeLists.txt)
+and regenerate it after changing the machine or driver.
+"""
+
+import argparse
+import json
+import sys
+
+# Convert every time to nanoseconds so mixed time units can be compared.
+TIME_UNITS = {"ns": 1.0, "us": 1.0e3, "ms": 1.0e6, "s": 1.0e9}
+
+
+def load(path, metric):
+    """Return {benchmark name: time in ns} from a benchmark JSON file."""
+    with open(path) as f:
+        data = json.load(f)
+
+    times = {}
+    medians = {}
+    for b in data.get("benchmarks", []):
+        if b.get("error_occurred"):
+            continue
+        value = b[metric] * TIME_UNITS[b.get("time_unit", "ns")]
+        if b.get("run_type") == "aggregate":
+            if b.get("aggregate_name") == "median":
+                medians[b["run_name"]] = value
+        else:
+            times.setdefault(b.get("run_name", b["name"]), value)
+
+    times.update(medians)
+    return data.get("context", {}), times
+
+
+def check_context(path, context):
+    """Warn about recording conditions that make the timings unreliable."""
+    if context.get("library_build_type", "release") != "release":
+        print("Warning: %s was recorded with a %s build of Google Benchmark; "
+              "re-record it with a release build (-DOPENGL_INTRO_FETCH_BENCHMARK=ON)."
+              % (path, context["library_build_type"]), file=sys.stderr)
+
+
+def format_time(ns):
+    for unit in ("s", "ms", "us"):
+        if ns >= TIME_UNITS[unit]:
+            return "%.3g %s" % (ns / TIME_UNITS[unit], unit)
+    return "%.3g ns" % ns
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("baseline")
+    parser.add_argument("result")
+    parser.add_argument("--threshold", type=float, default=10.0, help="allowed slowdown in percent (default: 10)")
+    parser.add_argument("--metric", choices=("real_time", "cpu_time"), default="real_time")
+    args = parser.parse_args()
+
+    baseline_context, baseline = load(args.baseline, args.metric)
+    result_context, result = load(args.result, args.metric)
+    check_context(args.baseline, baseline_context)
+    check_context(args.result, result_context)
+    if baseline_context.get("num_cpus") != result_context.get("num_cpus"):
+        print("Warning: the baseline was recorded on %s CPU(s) but the result on %s; "
+              "the threaded cases are not comparable."
+              % (baseline_context.get("num_cpus"), result_context.get("num_cpus")), file=sys.stderr)
+
+    regressions = 0
+    width = max([len(name) for name in result] + [9])
+    print("%-*s %12s %12s %9s" % (width, "Benchmark", "Baseline", "Current", "Change"))
+    for name in sorted(result):
+        current = result[name]
+        if name not in baseline:
+            print("%-*s %12s %12s %9s" % (width, name, "-", format_time(current), "new"))
+            continue
+
+        change = (current - baseline[name]) / baseline[name] * 100.0
+        mark = ""
+        if change > args.threshold:
+            mark = "  REGRESSION"
+            regressions += 1
+        print("%-*s %12s %12s %+8.1f%%%s" % (width, name, format_time(baseline[name]), format_time(current), change, mark))
+
+    for name in sorted(set(baseline) - set(result)):
+        print("%-*s %12s %12s %9s" % (width, name, format_time(baseline[name]), "-", "missing"))
+
+    if regressions:
+        print("%d benchmark(s) regressed by more than %.1f%%." % (regressions, args.threshold))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
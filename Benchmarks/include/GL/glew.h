@@ -0,0 +1,30 @@
+#pragma once
+
+//
+// ベンチマーク用の GLEW の代わり
+//   ヘッドレスの EGL コンテキストでは glewInit() が使えないので、
+//   Mesa の libOpenGL が公開している関数を直接呼ぶ
+//
+#define GL_GLEXT_PROTOTYPES
+#include <GL/glcorearb.h>
+
+#ifndef GLAPIENTRY
+#define GLAPIENTRY APIENTRY
+#endif
+
+#include <cstring>
+
+// 現在のコンテキストが拡張機能 name を持っているか
+inline GLboolean glewShimIsSupported(const char* name) {
+	GLint count(0);
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; ++i) {
+		const GLubyte* const extension(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+		if (extension != nullptr && std::strcmp(reinterpret_cast<const char*>(extension), name) == 0) return GL_TRUE;
+	}
+	return GL_FALSE;
+}
+
+// GLEW と同じく、コンテキストを作った後で調べる
+#define GLEW_KHR_debug glewShimIsSupported("GL_KHR_debug")
+#define GLEW_ARB_timer_query glewShimIsSupported("GL_ARB_timer_query")
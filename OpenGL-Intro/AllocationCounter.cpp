@@ -0,0 +1,90 @@
+#include <cstdlib>
+#include <new>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+#include "AllocationCounter.hpp"
+
+namespace {
+	// スレッドごとの確保回数とバイト数
+	thread_local std::size_t allocationCount(0);
+	thread_local std::size_t allocationBytes(0);
+
+	void* countedAllocate(std::size_t size) {
+		++allocationCount;
+		allocationBytes += size;
+
+		void* const p(std::malloc(size != 0 ? size : 1));
+		if (p == nullptr) throw std::bad_alloc();
+		return p;
+	}
+
+	// alignof(std::max_align_t) を超える境界の確保（C++17 の align_val_t 付きの new）
+	void* countedAlignedAllocate(std::size_t size, std::align_val_t alignment) {
+		++allocationCount;
+		allocationBytes += size;
+
+		const std::size_t a(static_cast<std::size_t>(alignment));
+#ifdef _MSC_VER
+		void* const p(_aligned_malloc(size != 0 ? size : 1, a));
+#else
+		// aligned_alloc() の大きさは境界の倍数でなければならない
+		void* const p(std::aligned_alloc(a, size != 0 ? (size + a - 1) / a * a : a));
+#endif
+		if (p == nullptr) throw std::bad_alloc();
+		return p;
+	}
+
+	void alignedFree(void* p) {
+#ifdef _MSC_VER
+		_aligned_free(p);
+#else
+		std::free(p);
+#endif
+	}
+}
+
+std::size_t AllocationCounter::count() { return allocationCount; }
+std::size_t AllocationCounter::bytes() { return allocationBytes; }
+
+// ---------------------------------------------------------------- //
+//	Replaceable global allocation functions
+// ---------------------------------------------------------------- //
+void* operator new(std::size_t size) { return countedAllocate(size); }
+void* operator new[](std::size_t size) { return countedAllocate(size); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	try { return countedAllocate(size); }
+	catch (...) { return nullptr; }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+	try { return countedAllocate(size); }
+	catch (...) { return nullptr; }
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) { return countedAlignedAllocate(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return countedAlignedAllocate(size, alignment); }
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	try { return countedAlignedAllocate(size, alignment); }
+	catch (...) { return nullptr; }
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	try { return countedAlignedAllocate(size, alignment); }
+	catch (...) { return nullptr; }
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { alignedFree(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { alignedFree(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { alignedFree(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { alignedFree(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { alignedFree(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { alignedFree(p); }
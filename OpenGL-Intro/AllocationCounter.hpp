@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+
+//
+// ヒープ確保の回数を数えるフック
+//   AllocationCounter.cpp で置き換えたグローバルな operator new が呼ばれるたびに数える
+//   カウンタはスレッドごとなので、他のスレッドの確保とは競合しない
+//
+namespace AllocationCounter {
+	// このスレッドで operator new が呼ばれた回数
+	std::size_t count();
+
+	// このスレッドで確保したバイト数の累計
+	std::size_t bytes();
+}
+
+//
+// スコープ内のヒープ確保の回数を調べる
+//   定常状態のフレームが 0 回であることを確かめるのに使う
+//
+class AllocationScope {
+private:
+	const std::size_t _start;
+
+public:
+	AllocationScope()
+		: _start(AllocationCounter::count())
+	{
+	}
+
+	// このスコープに入ってからの確保回数
+	std::size_t getCount() const { return AllocationCounter::count() - _start; }
+};
@@ -0,0 +1,159 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//
+// 線形（バンプ）アロケータ
+//   フレーム内だけで使う一時データ（描画リストなど）を確保し、フレームの最後にまとめて捨てる
+//   スレッドごと・フレームごとに持つのでロックは取らない
+//
+class LinearArena {
+private:
+	// 確保済みのメモリ
+	std::unique_ptr<unsigned char[]> _buffer;
+
+	// 容量
+	std::size_t _capacity;
+
+	// 次に確保する位置
+	std::size_t _offset;
+
+	// 最大使用量
+	std::size_t _peak;
+
+	// UnCopiable
+	LinearArena(const LinearArena& o) = delete;
+	LinearArena& operator=(const LinearArena& rhs) = delete;
+
+public:
+	LinearArena(std::size_t capacity)
+		: _buffer(new unsigned char[capacity])
+		, _capacity(capacity)
+		, _offset(0)
+		, _peak(0)
+	{
+	}
+
+	// size バイトを alignment の境界に確保する
+	//   容量が足りなければ nullptr を返す
+	void* allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t)) {
+		const std::uintptr_t base(reinterpret_cast<std::uintptr_t>(_buffer.get()));
+		const std::uintptr_t p((base + _offset + alignment - 1) & ~(static_cast<std::uintptr_t>(alignment) - 1));
+		const std::size_t offset(static_cast<std::size_t>(p - base));
+
+		if (offset + size > _capacity) {
+			std::cerr << "Error: Linear arena overflow." << std::endl;
+			return nullptr;
+		}
+
+		_offset = offset + size;
+		if (_offset > _peak) _peak = _offset;
+		return reinterpret_cast<void*>(p);
+	}
+
+	// T 型の配列を count 個確保する（デストラクタは呼ばれないので自明に破棄できる型に限る）
+	template <typename T>
+	T* allocate(std::size_t count = 1) {
+		static_assert(std::is_trivially_destructible<T>::value, "LinearArena only holds trivially destructible types.");
+		T* const p(static_cast<T*>(allocate(sizeof(T) * count, alignof(T))));
+		if (p != nullptr) {
+			for (std::size_t i = 0; i < count; ++i) new(p + i) T;
+		}
+		return p;
+	}
+
+	// 確保したメモリをすべて捨てる
+	void reset() { _offset = 0; }
+
+	// 確保したメモリをすべて捨て、容量を capacity 以上に広げる（それまでに確保したポインタはすべて無効になる）
+	void reserve(std::size_t capacity) {
+		_offset = 0;
+		if (capacity <= _capacity) return;
+		_buffer.reset(new unsigned char[capacity]);
+		_capacity = capacity;
+	}
+
+	std::size_t getUsed() const { return _offset; }
+	std::size_t getPeak() const { return _peak; }
+	std::size_t getCapacity() const { return _capacity; }
+};
+
+//
+// 固定容量のオブジェクトプール
+//   寿命の長いリソースを連続した領域に置き、空きスロットを再利用する
+//
+template <typename T>
+class Pool {
+private:
+	// スロットの領域
+	using Storage = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+	std::unique_ptr<Storage[]> _slots;
+
+	// 使用中のスロットかどうか
+	std::unique_ptr<bool[]> _used;
+
+	// 空きスロットの番号
+	std::vector<std::uint32_t> _free;
+
+	// 容量
+	const std::uint32_t _capacity;
+
+	// UnCopiable
+	Pool(const Pool& o) = delete;
+	Pool& operator=(const Pool& rhs) = delete;
+
+public:
+	Pool(std::uint32_t capacity)
+		: _slots(new Storage[capacity])
+		, _used(new bool[capacity]())
+		, _capacity(capacity)
+	{
+		// 番号の小さいスロットから使う
+		_free.reserve(capacity);
+		for (std::uint32_t i = capacity; i > 0; --i) _free.push_back(i - 1);
+	}
+
+	virtual ~Pool() {
+		for (std::uint32_t i = 0; i < _capacity; ++i) {
+			if (_used[i]) get(i)->~T();
+		}
+	}
+
+	// オブジェクトを作成してスロット番号を返す
+	//   空きがなければ capacity を返す
+	template <typename... Args>
+	std::uint32_t create(Args&&... args) {
+		if (_free.empty()) {
+			std::cerr << "Error: Pool is full." << std::endl;
+			return _capacity;
+		}
+
+		const std::uint32_t index(_free.back());
+		_free.pop_back();
+		new(&_slots[index]) T(std::forward<Args>(args)...);
+		_used[index] = true;
+		return index;
+	}
+
+	// スロットのオブジェクトを破棄する
+	void destroy(std::uint32_t index) {
+		if (index >= _capacity || !_used[index]) return;
+		get(index)->~T();
+		_used[index] = false;
+		_free.push_back(index);
+	}
+
+	T* get(std::uint32_t index) { return reinterpret_cast<T*>(&_slots[index]); }
+	const T* get(std::uint32_t index) const { return reinterpret_cast<const T*>(&_slots[index]); }
+
+	bool isUsed(std::uint32_t index) const { return index < _capacity && _used[index]; }
+
+	std::uint32_t getCapacity() const { return _capacity; }
+	std::uint32_t getCount() const { return _capacity - static_cast<std::uint32_t>(_free.size()); }
+};
@@ -0,0 +1,131 @@
+#pragma once
+#include <GL/glew.h>
+#include "Object.hpp"
+#include "Telemetry.hpp"
+
+//
+// 毎フレーム頂点を書き換える図形データ
+//   頂点バッファを regions 個の領域に分けたリングとして使い、
+//   GPU が読んでいない領域に同期なしで書き込む
+//   一部の頂点だけの書き換え（update）と記憶領域ごとの書き換え（orphan）もできる
+//
+class DynamicObject {
+private:
+	// 頂点配列オブジェクト
+	GLuint _vao;
+
+	// 頂点バッファオブジェクト（regions 個の領域からなるリング）
+	GLuint _vbo;
+
+	// 頂点インデックスバッファオブジェクト
+	GLuint _ibo;
+
+	// 1領域の頂点数
+	const GLsizei _vertexCount;
+
+	// 頂点インデックスの数
+	const GLsizei _indexCount;
+
+	// リングの領域数
+	const GLsizei _regions;
+
+	// 描画に使う領域
+	GLsizei _current;
+
+	// UnCopiable
+	DynamicObject(const DynamicObject& o) = delete;
+	DynamicObject& operator=(const DynamicObject& rhs) = delete;
+
+	// 領域の先頭のバイト位置
+	GLintptr regionOffset(GLsizei region) const {
+		return static_cast<GLintptr>(region) * _vertexCount * sizeof(Object::Vertex);
+	}
+
+public:
+	// regions: リングの領域数（先行するフレーム数以上にする）
+	DynamicObject(GLint size, GLsizei vertexCount, const Object::Vertex* vertex,
+		GLsizei indexCount, const GLuint* index, GLsizei regions = 3)
+		: _vertexCount(vertexCount)
+		, _indexCount(indexCount)
+		, _regions(regions > 0 ? regions : 1)
+		, _current(0)
+	{
+		// 頂点配列オブジェクト作成
+		glGenVertexArrays(1, &_vao);
+		glBindVertexArray(_vao);
+
+		// 全領域分の頂点バッファオブジェクトを確保して最初の領域に初期値を入れる
+		glGenBuffers(1, &_vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+		glBufferData(GL_ARRAY_BUFFER, regionOffset(_regions), nullptr, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, regionOffset(1), vertex);
+		Telemetry::add(Telemetry::BUFFER_BYTES, regionOffset(_regions));
+
+		// 結合済みの頂点バッファオブジェクトをシェーダのin変数から参照できるようにする
+		glVertexAttribPointer(0, size, GL_FLOAT, GL_FALSE, sizeof(Object::Vertex), 0);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Object::Vertex), static_cast<char*>(0) + sizeof(Object::Vertex::position));
+		glEnableVertexAttribArray(1);
+
+		// 頂点インデックスは変わらないので GL_STATIC_DRAW で作る
+		glGenBuffers(1, &_ibo);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ibo);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(GLuint), index, GL_STATIC_DRAW);
+		Telemetry::add(Telemetry::BUFFER_BYTES, indexCount * sizeof(GLuint));
+	}
+
+	virtual ~DynamicObject() {
+		glDeleteVertexArrays(1, &_vao);
+		glDeleteBuffers(1, &_vbo);
+		glDeleteBuffers(1, &_ibo);
+	}
+
+	// リングの次の領域を書き込み用にマップする
+	//   この領域を前に描いたフレームのフェンスを待ってから呼び出すこと
+	//   戻り値: 頂点の書き込み先（unmap() を呼ぶまで有効, マップできなければ nullptr で、この領域は描かない）
+	Object::Vertex* map() {
+		_current = (_current + 1) % _regions;
+
+		glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+		return static_cast<Object::Vertex*>(glMapBufferRange(GL_ARRAY_BUFFER,
+			regionOffset(_current), regionOffset(1),
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+	}
+
+	// map() した領域を書き込み終える
+	//   戻り値: 書き込んだ内容が有効か（false なら領域の内容は不定なので描かない）
+	bool unmap() {
+		glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+		return glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE;
+	}
+
+	// 描画に使う領域の頂点の一部だけを書き換える
+	//   first: 最初の頂点の番号, count: 頂点数
+	//   GPU がまだこの領域を読んでいれば、ドライバが同期するか複製する
+	void update(GLsizei first, GLsizei count, const Object::Vertex* vertex) {
+		glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+		glBufferSubData(GL_ARRAY_BUFFER,
+			regionOffset(_current) + first * sizeof(Object::Vertex), count * sizeof(Object::Vertex), vertex);
+	}
+
+	// 頂点バッファの記憶領域を捨てて（orphaning）描画に使う領域を書き換える
+	//   GPU が読んでいる古い記憶領域はドライバが描画の完了後に解放する
+	//   ほかの領域の内容は不定になるが、次の map() は領域全体を書き込むので問題ない
+	void orphan(const Object::Vertex* vertex) {
+		glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+		glBufferData(GL_ARRAY_BUFFER, regionOffset(_regions), nullptr, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, regionOffset(_current), regionOffset(1), vertex);
+		Telemetry::add(Telemetry::BUFFER_BYTES, regionOffset(_regions));
+	}
+
+	// 描画に使う領域の頂点で描画する
+	void draw() const {
+		glBindVertexArray(_vao);
+		Telemetry::add(Telemetry::VAO_BINDS);
+		glDrawElementsBaseVertex(GL_TRIANGLES, _indexCount, GL_UNSIGNED_INT, 0, _current * _vertexCount);
+		Telemetry::draw(GL_TRIANGLES, _indexCount);
+	}
+
+	GLsizei getVertexCount() const { return _vertexCount; }
+	GLsizei getIndexCount() const { return _indexCount; }
+};
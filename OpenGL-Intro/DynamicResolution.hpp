@@ -0,0 +1,242 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <GL/glew.h>
+
+//
+// フレーム時間から解像度の倍率を決める制御
+//   予算を超えたらすぐに下げ、予算に余裕のある状態が続いたときだけ少しずつ上げる
+//   倍率を変えた直後は計測が追いつくまで変えない（ヒステリシス）
+//
+class ResolutionController {
+public:
+	// 制御の設定
+	struct Settings {
+		double budget;		// フレーム時間の予算（秒）
+		float minScale;		// 倍率の下限
+		float maxScale;		// 倍率の上限
+		float step;			// 上げるときの倍率の刻み
+		double lower;		// 予算のこの割合より短い状態が続いたら上げる
+		double upper;		// 予算のこの割合より長くなったら下げる
+		int patience;		// 上げる前に余裕のある状態が続くフレーム数
+		int cooldown;		// 倍率を変えた後に変えないフレーム数
+		double smoothing;	// フレーム時間の指数移動平均の重み
+	};
+
+	// 60 Hz で 0.5〜1.0 倍
+	static constexpr Settings defaultSettings = { 1.0 / 60.0, 0.5f, 1.0f, 0.05f, 0.8, 0.95, 30, 8, 0.2 };
+
+private:
+	const Settings _settings;
+
+	// 現在の倍率
+	float _scale;
+
+	// フレーム時間の指数移動平均
+	double _average;
+
+	// 余裕のある状態が続いたフレーム数
+	int _calm;
+
+	// 次に倍率を変えられるまでのフレーム数
+	int _hold;
+
+public:
+	ResolutionController(const Settings& settings = defaultSettings)
+		: _settings(settings)
+		, _scale(settings.maxScale)
+		, _average(0.0)
+		, _calm(0)
+		, _hold(0)
+	{
+	}
+
+	// フレーム時間を与えて倍率を更新する
+	//   戻り値: 新しい倍率
+	float update(double time) {
+		_average = _average > 0.0 ? _average + _settings.smoothing * (time - _average) : time;
+
+		if (_hold > 0) {
+			--_hold;
+			return _scale;
+		}
+
+		if (_average > _settings.budget * _settings.upper) {
+			// 描画の負荷は画素数（倍率の2乗）に比例するとみて予算に収まる倍率まで一度に下げる
+			const float target(_scale * static_cast<float>(std::sqrt(_settings.budget * _settings.lower / _average)));
+			change(std::min(target, _scale - _settings.step));
+		}
+		else if (_average < _settings.budget * _settings.lower) {
+			if (++_calm >= _settings.patience) change(_scale + _settings.step);
+		}
+		else {
+			_calm = 0;
+		}
+
+		return _scale;
+	}
+
+	// 倍率を変える
+	void change(float scale) {
+		scale = std::min(std::max(scale, _settings.minScale), _settings.maxScale);
+		if (scale == _scale) return;
+
+		_scale = scale;
+		_calm = 0;
+		_hold = _settings.cooldown;
+
+		// 前の倍率での計測は捨てる
+		_average = 0.0;
+	}
+
+	float getScale() const { return _scale; }
+	double getAverage() const { return _average; }
+	const Settings& getSettings() const { return _settings; }
+};
+
+//
+// 動的解像度のシーン描画
+//   シーンはウィンドウより小さくできるフレームバッファオブジェクトに描き、
+//   既定のフレームバッファに拡大して転送する
+//   シーンの描画にかかった GPU の時間をタイマークエリで測り、倍率を決める
+//
+class DynamicResolution {
+private:
+	// 先行するフレームの分だけタイマークエリを持つ
+	static constexpr int QUERY_COUNT = 4;
+
+	// シーンを描くフレームバッファオブジェクトとそのカラー・デプスのレンダーバッファ
+	GLuint _fbo, _color, _depth;
+
+	// レンダーバッファを確保した大きさ（ウィンドウの大きさ）
+	GLsizei _width, _height;
+
+	// このフレームでシーンを描く大きさ
+	GLsizei _sceneWidth, _sceneHeight;
+
+	// GPU の時間を測るタイマークエリのリング
+	GLuint _queries[QUERY_COUNT];
+	bool _issued[QUERY_COUNT];
+	int _next;
+
+	// タイマークエリが使えるか
+	const bool _timer;
+
+	// 直前に読み出したシーンの GPU の時間（秒）
+	double _gpuTime;
+
+	ResolutionController _controller;
+
+	// UnCopiable
+	DynamicResolution(const DynamicResolution& o) = delete;
+	DynamicResolution& operator=(const DynamicResolution& rhs) = delete;
+
+	// レンダーバッファをウィンドウの大きさに合わせる（倍率を変えてもここでは作り直さない）
+	void reallocate(GLsizei width, GLsizei height) {
+		glBindRenderbuffer(GL_RENDERBUFFER, _color);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, _depth);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _color);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depth);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			std::cerr << "Error: Scene framebuffer is incomplete." << std::endl;
+		}
+
+		_width = width;
+		_height = height;
+	}
+
+	// 終わっているタイマークエリの結果を発行した順に受け取る
+	//   _next が最も古いスロットなので、そこから回ってまだ結果の出ていないクエリで止める
+	//   （新しいフレームの時間を古いフレームの時間より先に制御に与えない）
+	void poll() {
+		for (int k = 0; k < QUERY_COUNT; ++k) {
+			const int i((_next + k) % QUERY_COUNT);
+			if (!_issued[i]) continue;
+
+			GLint available(GL_FALSE);
+			glGetQueryObjectiv(_queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available == GL_FALSE) break;
+
+			GLuint64 elapsed(0);
+			glGetQueryObjectui64v(_queries[i], GL_QUERY_RESULT, &elapsed);
+			_issued[i] = false;
+
+			_gpuTime = static_cast<double>(elapsed) * 1.0e-9;
+			_controller.update(_gpuTime);
+		}
+	}
+
+public:
+	DynamicResolution(const ResolutionController::Settings& settings = ResolutionController::defaultSettings)
+		: _width(0)
+		, _height(0)
+		, _sceneWidth(0)
+		, _sceneHeight(0)
+		, _next(0)
+		, _timer(GLEW_ARB_timer_query != GL_FALSE)
+		, _gpuTime(0.0)
+		, _controller(settings)
+	{
+		glGenFramebuffers(1, &_fbo);
+		glGenRenderbuffers(1, &_color);
+		glGenRenderbuffers(1, &_depth);
+
+		glGenQueries(QUERY_COUNT, _queries);
+		std::fill(_issued, _issued + QUERY_COUNT, false);
+
+		if (!_timer) {
+			std::cerr << "Warning: GL_ARB_timer_query is not supported. The resolution scale is fixed." << std::endl;
+		}
+	}
+
+	virtual ~DynamicResolution() {
+		glDeleteQueries(QUERY_COUNT, _queries);
+		glDeleteRenderbuffers(1, &_depth);
+		glDeleteRenderbuffers(1, &_color);
+		glDeleteFramebuffers(1, &_fbo);
+	}
+
+	// シーンの描画を始める（フレームバッファオブジェクトを結合してビューポートを縮める）
+	//   width, height: ウィンドウの大きさ
+	void begin(GLsizei width, GLsizei height) {
+		if (width != _width || height != _height) reallocate(width, height);
+
+		if (_timer) poll();
+
+		const float scale(_controller.getScale());
+		_sceneWidth = std::max(1, static_cast<GLsizei>(width * scale + 0.5f));
+		_sceneHeight = std::max(1, static_cast<GLsizei>(height * scale + 0.5f));
+
+		glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+		glViewport(0, 0, _sceneWidth, _sceneHeight);
+
+		// 前のクエリの結果がまだ出ていなければこのフレームは測らない
+		if (_timer && !_issued[_next]) glBeginQuery(GL_TIME_ELAPSED, _queries[_next]);
+	}
+
+	// シーンの描画を終えて既定のフレームバッファに拡大して転送する
+	void end() {
+		if (_timer && !_issued[_next]) {
+			glEndQuery(GL_TIME_ELAPSED);
+			_issued[_next] = true;
+		}
+		_next = (_next + 1) % QUERY_COUNT;
+
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, _fbo);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		glBlitFramebuffer(0, 0, _sceneWidth, _sceneHeight, 0, 0, _width, _height, GL_COLOR_BUFFER_BIT,
+			_sceneWidth == _width && _sceneHeight == _height ? GL_NEAREST : GL_LINEAR);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(0, 0, _width, _height);
+	}
+
+	float getScale() const { return _controller.getScale(); }
+	double getGpuTime() const { return _gpuTime; }
+	const ResolutionController& getController() const { return _controller; }
+};
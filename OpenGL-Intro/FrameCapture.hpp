@@ -0,0 +1,289 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <GL/glew.h>
+#include "LockFreeQueue.hpp"
+#include "Telemetry.hpp"
+
+//
+// 画面の非同期キャプチャ
+//   glReadPixels をピクセルパックバッファのリングに読み出し、
+//   数フレーム後にフェンスを確認してからマップして書き出しスレッドに渡す
+//   描画スレッドはフェンスを待たず、画素のコピーもしない（書き出しスレッドがマップした領域から直接書き出す）
+//
+class FrameCapture {
+public:
+	// 書き出す形式
+	enum Format {
+		RAW,	// RGBA 8bit（下の行から）
+		PPM		// バイナリ PPM（P6）
+	};
+
+private:
+	// 読み出し中のピクセルパックバッファ
+	struct Slot {
+		GLuint pbo;
+		GLsync fence;
+		GLsizei width, height;
+		unsigned long long frame;
+
+		// 書き出しスレッドに渡したマップ中の領域（描画スレッドが書き出し後にアンマップする）
+		const unsigned char* mapped;
+
+		// 書き出しスレッドが mapped を使っている間は true
+		std::atomic<bool> writing;
+	};
+
+	// 書き出しスレッドに渡す画像
+	struct Image {
+		const unsigned char* pixels;
+		GLsizei width, height;
+		unsigned long long frame;
+		Slot* slot;
+	};
+
+	// ピクセルパックバッファのリング
+	std::vector<Slot> _slots;
+
+	// 次に読み出すスロット
+	std::size_t _next;
+
+	// バッファを確保した大きさ
+	GLsizei _width, _height;
+
+	// 書き出すファイル名の先頭と形式
+	const std::string _prefix;
+	const Format _format;
+
+	// 描画スレッド → 書き出しスレッド
+	LockFreeQueue<Image> _written;
+
+	// 書き出しスレッドを起こすための同期
+	std::mutex _mutex;
+	std::condition_variable _wakeup;
+	std::atomic<bool> _running;
+	std::thread _thread;
+
+	// GPU の読み出しか書き出しが追いつかずに捨てたフレーム数
+	unsigned long long _dropped;
+
+	// 直前の capture() にかかった時間（秒）
+	double _captureTime;
+
+	// UnCopiable
+	FrameCapture(const FrameCapture& o) = delete;
+	FrameCapture& operator=(const FrameCapture& rhs) = delete;
+
+	// 書き出しスレッドの処理
+	void run() {
+		std::vector<unsigned char> row;
+
+		for (;;) {
+			Image image;
+			if (!_written.pop(image)) {
+				if (!_running.load()) break;
+
+				// 画像が来るまで眠る
+				std::unique_lock<std::mutex> lock(_mutex);
+				_wakeup.wait(lock, [this] { return !_running.load() || !_written.empty(); });
+				continue;
+			}
+
+			write(image, row);
+
+			// 描画スレッドにアンマップしてもらう
+			image.slot->writing.store(false, std::memory_order_release);
+		}
+	}
+
+	// 画像をファイルに書き出す
+	void write(const Image& image, std::vector<unsigned char>& row) const {
+		char number[32];
+		std::snprintf(number, sizeof number, "%06llu", image.frame);
+		const std::string name(_prefix + number + (_format == PPM ? ".ppm" : ".raw"));
+
+		std::ofstream file(name, std::ios::binary);
+		if (file.fail()) {
+			std::cerr << "Error: Can't open capture file: " << name << std::endl;
+			return;
+		}
+
+		if (_format == RAW) {
+			file.write(reinterpret_cast<const char*>(image.pixels), static_cast<std::streamsize>(image.width) * image.height * 4);
+			return;
+		}
+
+		// PPM は上の行から RGB で並べる
+		file << "P6\n" << image.width << " " << image.height << "\n255\n";
+		row.resize(static_cast<std::size_t>(image.width) * 3);
+		for (GLsizei y = image.height; y-- > 0;) {
+			const unsigned char* const src(image.pixels + static_cast<std::size_t>(y) * image.width * 4);
+			for (GLsizei x = 0; x < image.width; ++x) {
+				row[x * 3 + 0] = src[x * 4 + 0];
+				row[x * 3 + 1] = src[x * 4 + 1];
+				row[x * 3 + 2] = src[x * 4 + 2];
+			}
+			file.write(reinterpret_cast<const char*>(row.data()), row.size());
+		}
+	}
+
+	// 書き出しスレッドが使い終わった領域をアンマップする
+	void release(Slot& slot) {
+		if (slot.mapped == nullptr || slot.writing.load(std::memory_order_acquire)) return;
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		slot.mapped = nullptr;
+	}
+
+	// スロットのフェンスが通過していればマップし、書き出しスレッドに渡す
+	//   wait: フェンスを待つか（描画中は待たず、終了時だけ待つ）
+	void retrieve(Slot& slot, bool wait) {
+		if (slot.fence == nullptr) return;
+
+		// 待たないときもフェンスまでの命令は送り出しておく（送らないとフェンスがいつまでも通過しない）
+		const GLenum status(glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? 1000000000ULL : 0));
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return;
+		glDeleteSync(slot.fence);
+		slot.fence = nullptr;
+
+		const GLsizeiptr size(static_cast<GLsizeiptr>(slot.width) * slot.height * 4);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+		const void* const src(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT));
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		if (src == nullptr) {
+			++_dropped;
+			return;
+		}
+
+		slot.mapped = static_cast<const unsigned char*>(src);
+		slot.writing.store(true, std::memory_order_relaxed);
+		if (!_written.push({ slot.mapped, slot.width, slot.height, slot.frame, &slot })) {
+			// 書き出しが追いついていなければこのフレームは捨てる
+			slot.writing.store(false, std::memory_order_relaxed);
+			release(slot);
+			++_dropped;
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		_wakeup.notify_one();
+	}
+
+	// ピクセルパックバッファを width x height に合わせる
+	//   書き出し中のバッファがあれば何もせずに false を返す
+	bool reallocate(GLsizei width, GLsizei height) {
+		for (Slot& slot : _slots) {
+			release(slot);
+			if (slot.mapped != nullptr) return false;
+		}
+
+		for (Slot& slot : _slots) {
+			// 読み出し中のフレームは捨てる
+			if (slot.fence != nullptr) {
+				glDeleteSync(slot.fence);
+				slot.fence = nullptr;
+				++_dropped;
+			}
+
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+			glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(width) * height * 4, nullptr, GL_STREAM_READ);
+			Telemetry::add(Telemetry::BUFFER_BYTES, static_cast<std::uint64_t>(width) * height * 4);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		_width = width;
+		_height = height;
+		return true;
+	}
+
+public:
+	// prefix: 書き出すファイル名の先頭, format: 書き出す形式, count: リングのバッファ数
+	FrameCapture(const std::string& prefix = "capture_", Format format = PPM, int count = 3)
+		: _slots(count > 1 ? count : 2)
+		, _next(0)
+		, _width(0)
+		, _height(0)
+		, _prefix(prefix)
+		, _format(format)
+		, _written(_slots.size() + 1)
+		, _running(true)
+		, _dropped(0)
+		, _captureTime(0.0)
+	{
+		for (Slot& slot : _slots) {
+			glGenBuffers(1, &slot.pbo);
+			slot.fence = nullptr;
+			slot.mapped = nullptr;
+			slot.writing.store(false);
+		}
+
+		_thread = std::thread(&FrameCapture::run, this);
+	}
+
+	virtual ~FrameCapture() {
+		// 読み出し中のフレームを書き出してから終わる
+		for (std::size_t i = 0; i < _slots.size(); ++i) retrieve(_slots[(_next + i) % _slots.size()], true);
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_running.store(false);
+		}
+		_wakeup.notify_one();
+		_thread.join();
+
+		for (Slot& slot : _slots) {
+			release(slot);
+			if (slot.fence != nullptr) glDeleteSync(slot.fence);
+			glDeleteBuffers(1, &slot.pbo);
+		}
+	}
+
+	// 現在のフレームバッファの読み出しを始める（バッファを入れ替える前に呼ぶ）
+	//   frame: フレームの番号
+	//   次のスロットの GPU の読み出しか書き出しが終わっていなければ、待たずにこのフレームを捨てる
+	void capture(GLsizei width, GLsizei height, unsigned long long frame) {
+		const auto start(std::chrono::steady_clock::now());
+
+		// 読み出しが終わったスロットを書き出しスレッドに渡し、書き出しが終わったスロットを空ける
+		for (Slot& slot : _slots) {
+			retrieve(slot, false);
+			release(slot);
+		}
+
+		// 大きさが変わったらバッファを作り直す（書き出し中のバッファがあれば次のフレームに回す）
+		const bool ready((width == _width && height == _height) || reallocate(width, height));
+
+		Slot& slot(_slots[_next]);
+		if (!ready || slot.fence != nullptr || slot.mapped != nullptr) {
+			++_dropped;
+			_captureTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			return;
+		}
+
+		// ピクセルパックバッファへの読み出しは GPU の中で非同期に行われる
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		slot.width = width;
+		slot.height = height;
+		slot.frame = frame;
+		_next = (_next + 1) % _slots.size();
+
+		_captureTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	unsigned long long getDropped() const { return _dropped; }
+	double getCaptureTime() const { return _captureTime; }
+};
@@ -0,0 +1,179 @@
+#pragma once
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <GL/glew.h>
+#include "Telemetry.hpp"
+
+//
+// 1フレーム分の一時リソース
+//   GPUが読み終わるまでCPUから書き換えてはいけないバッファとフェンスを持つ
+//
+class FrameContext {
+private:
+	// フレームごとの一時ユニフォームバッファオブジェクト
+	GLuint _ubo;
+
+	// 一時バッファの容量
+	const GLsizeiptr _capacity;
+
+	// 次に書き込む位置
+	GLintptr _offset;
+
+	// このフレームの描画命令の完了を待つフェンス
+	GLsync _fence;
+
+	// UnCopiable
+	FrameContext(const FrameContext& o) = delete;
+	FrameContext& operator=(const FrameContext& rhs) = delete;
+
+public:
+	FrameContext(GLsizeiptr capacity)
+		: _capacity(capacity)
+		, _offset(0)
+		, _fence(nullptr)
+	{
+		glGenBuffers(1, &_ubo);
+		glBindBuffer(GL_UNIFORM_BUFFER, _ubo);
+		glBufferData(GL_UNIFORM_BUFFER, _capacity, nullptr, GL_STREAM_DRAW);
+		Telemetry::add(Telemetry::BUFFER_BYTES, _capacity);
+	}
+
+	virtual ~FrameContext() {
+		if (_fence != nullptr) glDeleteSync(_fence);
+		glDeleteBuffers(1, &_ubo);
+	}
+
+	// このフレームのフェンスを待つ
+	//   戻り値: 待った時間（秒）
+	double wait() {
+		if (_fence == nullptr) return 0.0;
+
+		const auto start(std::chrono::steady_clock::now());
+
+		// フェンスに到達するまで待つ（最初の待ちでコマンドをフラッシュする）
+		GLbitfield flags(GL_SYNC_FLUSH_COMMANDS_BIT);
+		for (;;) {
+			const GLenum status(glClientWaitSync(_fence, flags, 1000000000ULL));
+			if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) break;
+			if (status == GL_WAIT_FAILED) {
+				std::cerr << "Error: glClientWaitSync failed." << std::endl;
+				break;
+			}
+			flags = 0;
+		}
+
+		glDeleteSync(_fence);
+		_fence = nullptr;
+
+		// GPUが読み終わったので一時バッファは先頭から再利用できる
+		_offset = 0;
+
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// このフレームの描画命令の後ろにフェンスを置く
+	void fence() {
+		if (_fence != nullptr) glDeleteSync(_fence);
+		_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	// 一時バッファにデータを書き込む
+	//   data: 書き込むデータ, size: データのサイズ, alignment: 書き込み位置の境界
+	//   戻り値: 書き込んだ位置（容量が足りなければ -1）
+	GLintptr push(const void* data, GLsizeiptr size, GLintptr alignment) {
+		const GLintptr offset((_offset + alignment - 1) / alignment * alignment);
+		if (offset + size > _capacity) {
+			std::cerr << "Error: Frame buffer overflow." << std::endl;
+			return -1;
+		}
+
+		// フェンスでGPUの読み出し完了を保証しているのでドライバの同期は不要
+		glBindBuffer(GL_UNIFORM_BUFFER, _ubo);
+		void* const dst(glMapBufferRange(GL_UNIFORM_BUFFER, offset, size,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+		if (dst == nullptr) return -1;
+		std::memcpy(dst, data, size);
+		glUnmapBuffer(GL_UNIFORM_BUFFER);
+		Telemetry::add(Telemetry::UNIFORM_BYTES, size);
+
+		_offset = offset + size;
+		return offset;
+	}
+
+	// 一時バッファの範囲を結合ポイントに結合する
+	//   bp: 結合ポイント, offset: push() が返した位置, size: データのサイズ
+	void select(GLuint bp, GLintptr offset, GLsizeiptr size) const {
+		glBindBufferRange(GL_UNIFORM_BUFFER, bp, _ubo, offset, size);
+		Telemetry::add(Telemetry::UBO_BINDS);
+	}
+};
+
+//
+// フレームの先行描画（frames in flight）
+//   CPUは最大 count フレームまでGPUに先行して次のフレームを準備する
+//
+class FramePipeline {
+private:
+	// フレームごとのリソース
+	std::vector<std::unique_ptr<FrameContext>> _frames;
+
+	// 現在のフレームの番号
+	std::size_t _current;
+
+	// ユニフォームバッファのオフセットの境界
+	GLint _alignment;
+
+	// 直前のフレームでGPUを待った時間（秒）
+	double _stallTime;
+
+	// 累計の待ち時間（秒）
+	double _totalStallTime;
+
+	// UnCopiable
+	FramePipeline(const FramePipeline& o) = delete;
+	FramePipeline& operator=(const FramePipeline& rhs) = delete;
+
+public:
+	// count: 先行するフレーム数（2〜3）, capacity: フレームごとの一時バッファの容量
+	FramePipeline(int count = 2, GLsizeiptr capacity = 64 * 1024)
+		: _current(0)
+		, _stallTime(0.0)
+		, _totalStallTime(0.0)
+	{
+		if (count < 2) count = 2;
+		if (count > 3) count = 3;
+
+		for (int i = 0; i < count; ++i) {
+			_frames.emplace_back(new FrameContext(capacity));
+		}
+
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &_alignment);
+	}
+
+	// フレームを開始する
+	//   GPUが count フレーム遅れているときだけここで待つ
+	FrameContext& begin() {
+		FrameContext& frame(*_frames[_current]);
+		_stallTime = frame.wait();
+		_totalStallTime += _stallTime;
+		return frame;
+	}
+
+	// フレームを終了する
+	void end() {
+		_frames[_current]->fence();
+		_current = (_current + 1) % _frames.size();
+	}
+
+	// 一時バッファの書き込み位置の境界
+	GLintptr getAlignment() const { return _alignment; }
+
+	// 先行するフレーム数
+	int getCount() const { return static_cast<int>(_frames.size()); }
+
+	double getStallTime() const { return _stallTime; }
+	double getTotalStallTime() const { return _totalStallTime; }
+};
@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+//
+// 固定容量の単一生産者・単一消費者キュー
+//   push() は生産者スレッドだけ、front() / pop() は消費者スレッドだけが呼び出す
+//
+template <typename T>
+class LockFreeQueue {
+private:
+	// 要素の格納先
+	std::unique_ptr<T[]> _items;
+
+	// 容量（2のべき乗）
+	const std::size_t _mask;
+
+	// 消費者が次に取り出す位置
+	alignas(64) std::atomic<std::size_t> _head;
+
+	// 生産者が次に格納する位置
+	alignas(64) std::atomic<std::size_t> _tail;
+
+	// UnCopiable
+	LockFreeQueue(const LockFreeQueue& o) = delete;
+	LockFreeQueue& operator=(const LockFreeQueue& rhs) = delete;
+
+	// capacity 以上の最小の2のべき乗
+	static std::size_t roundUp(std::size_t capacity) {
+		std::size_t n(1);
+		while (n < capacity) n <<= 1;
+		return n;
+	}
+
+public:
+	LockFreeQueue(std::size_t capacity)
+		: _items(new T[roundUp(capacity)])
+		, _mask(roundUp(capacity) - 1)
+		, _head(0)
+		, _tail(0)
+	{
+	}
+
+	// 要素を追加する（満杯なら false を返す）
+	bool push(T&& item) {
+		const std::size_t tail(_tail.load(std::memory_order_relaxed));
+		if (tail - _head.load(std::memory_order_acquire) > _mask) return false;
+
+		_items[tail & _mask] = std::move(item);
+		_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// 先頭の要素を取り出さずに参照する（空なら nullptr を返す）
+	T* front() {
+		const std::size_t head(_head.load(std::memory_order_relaxed));
+		if (head == _tail.load(std::memory_order_acquire)) return nullptr;
+		return &_items[head & _mask];
+	}
+
+	// 先頭の要素を取り出す（空なら false を返す）
+	bool pop(T& item) {
+		T* const p(front());
+		if (p == nullptr) return false;
+
+		item = std::move(*p);
+		_head.store(_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		return true;
+	}
+
+	// 先頭の要素を捨てる
+	void discard() {
+		if (front() != nullptr) {
+			_items[_head.load(std::memory_order_relaxed) & _mask] = T();
+			_head.store(_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+	}
+
+	bool empty() const {
+		return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+	}
+};
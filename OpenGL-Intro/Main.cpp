@@ -11,6 +11,21 @@
 #include "Vector.hpp"
 #include "Uniform.hpp"
 #include "Material.hpp"
+#include "Transform.hpp"
+#include "FrameContext.hpp"
+#include "Allocator.hpp"
+#include "AllocationCounter.hpp"
+#include "ResourceManager.hpp"
+#include "ResourceLoader.hpp"
+#include "DynamicObject.hpp"
+#include "OcclusionCuller.hpp"
+#include "FrameCapture.hpp"
+#include "MeshGenerator.hpp"
+#include "Telemetry.hpp"
+#include "TransformStore.hpp"
+#include "DynamicResolution.hpp"
+#include "ProceduralSphere.hpp"
+#include "ShadowMap.hpp"
 
 // ---------------------------------------------------------------- //
 //	Prototype declaration
@@ -20,21 +35,26 @@ GLboolean printShaderInfoLog(GLuint shader, const char* str);
 GLboolean printProgramInfoLog(GLuint program);
 bool readShaderSource(const char* name, std::vector<GLchar>& buffer);
 GLuint loadProgram(const char* vert, const char* frag);
+void deformSphere(GLsizei count, const Object::Vertex* base, GLfloat time, Object::Vertex* vertex);
+GLintptr pushTransform(FrameContext& frame, GLintptr alignment, const GLfloat* modelView, const GLfloat* normalMatrix, Transform& transform);
 
 // ---------------------------------------------------------------- //
 //	Global variables
 // ---------------------------------------------------------------- //
 
+// 球の分割数を設定（頂点属性と頂点インデックスはコンパイル時に作る）
+using SolidSphere = SphereMesh<16, 8>;
 
-// 六面体の面を塗りつぶす三角形の頂点のインデックス
-constexpr GLuint solidCubeIndex[] =
-{
-   0,  1,  2,  3,  4,  5, // 左
-   6,  7,  8,  9, 10, 11, // 裏
-  12, 13, 14, 15, 16, 17, // 下
-  18, 19, 20, 21, 22, 23, // 右
-  24, 25, 26, 27, 28, 29, // 上
-  30, 31, 32, 33, 34, 35  // 前
+// 影を受ける床の分割数
+using Ground = PlaneMesh<8>;
+
+// 描画リストの要素
+struct DrawItem {
+	const Shape* shape;					// 描画する図形
+	const Uniform<Material>* material;	// 図形のマテリアル
+	Matrix modelView;					// モデルビュー変換行列
+	GLintptr transform;					// 一時バッファ内の変換行列の位置
+	bool occluder;						// CPUの遮蔽カリングで遮蔽物として使うか
 };
 
 // ---------------------------------------------------------------- //
@@ -56,6 +76,9 @@ int main() {
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2); // select OpenGL vx.2
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // OpenGL v3.0以前の古い機能を使用しない前方互換プロファイル
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE); // OpenGL CoreProfileを使用
+#ifdef _DEBUG
+	glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE); // GL_KHR_debug のエラー通知をすべて受け取る
+#endif
 
 	// ウィンドウ作成
 	Window window;
@@ -73,67 +96,92 @@ int main() {
 	glDepthFunc(GL_LESS);
 	glEnable(GL_DEPTH_TEST);
 
+	// GLリソースの管理（ここで作成したリソースより後に破棄する）
+	ResourceManager manager;
+
 	// シェーダプログラムオブジェクトを作成
-	const GLuint program(loadProgram("point.vert", "point.frag"));
+	const ProgramHandle pointProgram(manager.addProgram(loadProgram("point.vert", "point.frag")));
+	const GLuint program(manager.getProgram(pointProgram));
 
 	// uniform変数の場所を取得
-	const GLint modelViewLocation(glGetUniformLocation(program, "modelView"));
-	const GLint projectionLocation(glGetUniformLocation(program, "projection"));
-	const GLint normalMatrixLocation(glGetUniformLocation(program, "normalMatrix"));
 	const GLint LposLocation(glGetUniformLocation(program, "Lpos"));
 	const GLint LambLocation(glGetUniformLocation(program, "Lamb"));
 	const GLint LdiffLocation(glGetUniformLocation(program, "Ldiff"));
 	const GLint LspecLocation(glGetUniformLocation(program, "Lspec"));
+	const GLint shadowMatrixLocation(glGetUniformLocation(program, "shadowMatrix"));
 
 	// uniform blockの場所を取得する
 	const GLint materialLocation(glGetUniformBlockIndex(program, "Material"));
+	const GLint transformLocation(glGetUniformBlockIndex(program, "Transform"));
 
 	// uniform blockの場所を0版の結合ポイントに結びつける
 	glUniformBlockBinding(program, materialLocation, 0);
 
-	// 球の分割数を設定
-	const int slices(16), stacks(8);
+	// 変換行列のuniform blockは1番の結合ポイントに結びつける
+	glUniformBlockBinding(program, transformLocation, 1);
 
-	// 頂点属性（頂点座標・法線）を作る
-	std::vector<Object::Vertex> solidSphereVertex;
+	// 頂点バッファを使わずに球を描くシェーダプログラムオブジェクトを作成
+	const ProgramHandle sphereProgram(manager.addProgram(loadProgram("sphere.vert", "point.frag")));
+	const GLuint procedural(manager.getProgram(sphereProgram));
 
-	for (int j = 0; j <= stacks; ++j) {
-		const float t(static_cast<float>(j) / static_cast<float>(stacks));
-		const float y(cos(3.141593f * t)), r(sin(3.141593f * t));
-		for (int i = 0; i <= slices; ++i) {
-			const float s(static_cast<float>(i) / static_cast<float>(slices));
-			const float z(r * cos(6.283185f * s)), x(r * sin(6.283185f * s));
+	// 光源の uniform 変数の場所は別に取得する
+	const GLint proceduralLposLocation(glGetUniformLocation(procedural, "Lpos"));
+	const GLint proceduralLambLocation(glGetUniformLocation(procedural, "Lamb"));
+	const GLint proceduralLdiffLocation(glGetUniformLocation(procedural, "Ldiff"));
+	const GLint proceduralLspecLocation(glGetUniformLocation(procedural, "Lspec"));
+	const GLint proceduralShadowMatrixLocation(glGetUniformLocation(procedural, "shadowMatrix"));
 
-			const Object::Vertex v = { x, y, z, x, y, z };
-			solidSphereVertex.emplace_back(v);
-		}
-	}
+	// uniform block は同じ結合ポイントに結びつける
+	glUniformBlockBinding(procedural, glGetUniformBlockIndex(procedural, "Material"), 0);
+	glUniformBlockBinding(procedural, glGetUniformBlockIndex(procedural, "Transform"), 1);
 
-	// 頂点インデックス配列を作成
-	std::vector<GLuint> solidSphereIndex;
-	for (int j = 0; j < stacks; ++j) {
-		const int k((slices + 1) * j);
-		for (int i = 0; i < slices; ++i) {
-			const GLuint k0(k + i);
-			const GLuint k1(k0 + 1);
-			const GLuint k2(k1 + slices);
-			const GLuint k3(k2 + 1);
-			
-			// 左下の三角形のインデックス
-			solidSphereIndex.push_back(k0);
-			solidSphereIndex.push_back(k2);
-			solidSphereIndex.push_back(k3);
-			// 左上の三角形のインデックス
-			solidSphereIndex.push_back(k0);
-			solidSphereIndex.push_back(k3);
-			solidSphereIndex.push_back(k1);
-		}
-	}
+	// シャドウマップはどちらのプログラムも0番のテクスチャユニットから読む
+	static constexpr GLuint shadowUnit(0);
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "shadowMap"), shadowUnit);
+	glUseProgram(procedural);
+	glUniform1i(glGetUniformLocation(procedural, "shadowMap"), shadowUnit);
+	glUseProgram(0);
 
 	// 図形データを作成
-	std::unique_ptr<const Shape> shapePtr(new SolidShapeIndex(3,
-		static_cast<GLsizei>(solidSphereVertex.size()), solidSphereVertex.data(),
-		static_cast<GLsizei>(solidSphereIndex.size()), solidSphereIndex.data()));
+	std::unique_ptr<const Shape> shapePtr(new SolidShapeIndex(manager, 3,
+		SolidSphere::vertexCount, SolidSphere::vertex.data(),
+		SolidSphere::indexCount, SolidSphere::index.data()));
+
+	// 描画スレッドとGLコンテキストを共有する読み込みスレッド
+	ResourceLoader loader(window.getHandle());
+
+	// 細かく分割した球をバックグラウンドで読み込み、読み込めたら差し替える
+	std::unique_ptr<const Shape> detailShapePtr;
+	loader.loadMesh(3,
+		[](std::vector<Object::Vertex>& vertex, std::vector<GLuint>& index) {
+			generateSphere(64, 32, vertex, index, 2);
+			return true;
+		},
+		[&](MeshHandle mesh, GLsizei vertexCount, GLsizei indexCount) {
+			if (!mesh.isNull()) detailShapePtr.reset(new SolidShapeIndex(manager, mesh, vertexCount, indexCount));
+		});
+
+	// 1つ目の球の上を回る小さな球（頂点バッファを持たず、インスタンスごとに中心と半径を変える）
+	ProceduralSphere satellites(manager, procedural, 12, 6);
+	static constexpr int satelliteCount(8);
+	GLfloat satellite[satelliteCount][4];
+	for (int i = 0; i < satelliteCount; ++i) {
+		const GLfloat a(6.283185f * i / satelliteCount);
+		satellite[i][0] = 1.2f * sin(a);
+		satellite[i][1] = 1.3f;
+		satellite[i][2] = 1.2f * cos(a);
+		satellite[i][3] = 0.2f;
+	}
+	satellites.setInstances(satelliteCount, satellite[0]);
+
+	// 影を受ける床と、その上に置いた動かない柱
+	std::unique_ptr<const Shape> groundPtr(new SolidShapeIndex(manager, 3,
+		Ground::vertexCount, Ground::vertex.data(),
+		Ground::indexCount, Ground::index.data()));
+	std::unique_ptr<const Shape> pillarPtr(new SolidShapeIndex(manager, 3,
+		CubeMesh::vertexCount, CubeMesh::vertex.data(),
+		CubeMesh::indexCount, CubeMesh::index.data()));
 
 	// 光源情報
 	static constexpr int Lcount(2);
@@ -142,14 +190,79 @@ int main() {
 	static constexpr GLfloat Ldiff[] = { 1.0f, 0.5f, 0.5f, 0.9f, 0.9f, 0.9f };
 	static constexpr GLfloat Lspec[] = { 1.0f, 0.5f, 0.5f, 0.9f, 0.9f, 0.9f };
 
+	// 光源から原点を見たデプスマップ（動かない物体の影はキャッシュして、光源が動いたときだけ描き直す）
+	static constexpr GLfloat Ltarget[] = { 0.0f, 0.0f, 0.0f };
+	const ProgramHandle shadowProgram(manager.addProgram(loadProgram("shadow.vert", "shadow.frag")));
+	ShadowMap shadow(manager.getProgram(shadowProgram), Lcount);
+
 	// マテリアル情報
 	static constexpr Material color[] =
 	{
 		{ 0.6f, 0.6f, 0.2f,  0.6f, 0.6f, 0.2f,  0.3f, 0.3f, 0.3f,  30.0f },
-		{ 0.1f, 0.1f, 0.5f,  0.1f, 0.1f, 0.5f,  0.4f, 0.4f, 0.4f,  60.0f }
+		{ 0.1f, 0.1f, 0.5f,  0.1f, 0.1f, 0.5f,  0.4f, 0.4f, 0.4f,  60.0f },
+		{ 0.5f, 0.5f, 0.5f,  0.7f, 0.7f, 0.7f,  0.1f, 0.1f, 0.1f,  10.0f }
+	};
+
+	const Uniform<Material> material[] = { { manager, &color[0] }, { manager, &color[1] }, { manager, &color[2] } };
+
+	// フレームごとの一時バッファ（GPUより2フレーム以上先行したときだけ待つ）
+	FramePipeline frames(2);
+
+	// 毎フレームCPUで変形させる球（先行するフレーム数だけ頂点バッファの領域を持つ）
+	DynamicObject animatedSphere(3,
+		SolidSphere::vertexCount, SolidSphere::vertex.data(),
+		SolidSphere::indexCount, SolidSphere::index.data(), frames.getCount());
+
+	// フレーム内だけで使う一時データの領域
+	LinearArena frameArena(64 * 1024);
+
+	// 遮蔽物を描くCPUのデプスバッファ
+	OcclusionCuller culler;
+
+	// 球の境界ボックス（変形させた球が収まる大きさ）
+	static constexpr GLfloat sphereMin[] = { -1.1f, -1.1f, -1.1f };
+	static constexpr GLfloat sphereMax[] = { 1.1f, 1.1f, 1.1f };
+
+	// 画面のキャプチャ（F12 キーで開始・停止する）
+	FrameCapture capture;
+	bool capturing(false), captureKey(false);
+
+	// 球の動き（P キーで止める・再開する）
+	//   止めている間は球も静的な物体として影をキャッシュし、シャドウマップを描き直さない
+	bool paused(false), pauseKey(false);
+	GLfloat sceneTime(0.0f), lastLocation[2] = { 0.0f, 0.0f };
+	double lastTime(0.0);
+
+	// 変形させた球の頂点の送り方（M キーで順に切り替える）
+	enum Streaming {
+		STREAM_MAP,			// リングの次の領域をマップして同期なしで書き込む
+		STREAM_SUB_DATA,	// 描画に使う領域を glBufferSubData() で書き換える
+		STREAM_ORPHAN,		// 記憶領域ごと捨ててから書き込む
+		STREAM_COUNT
 	};
+	int streaming(STREAM_MAP);
+	bool streamingKey(false);
+
+	// シーンを描く解像度をフレーム時間に合わせて変える（60 Hz の予算に収まるように 0.5〜1.0 倍）
+	DynamicResolution resolution;
+
+	// 描画の計測値（5秒ごとに移動平均を書き出す）
+	RenderStatistics stats(120, 5.0, "render_stats.csv");
 
-	const Uniform<Material> material[] = { &color[0], &color[1] };
+	// 1フレームの描画数
+	static constexpr int drawCount(2);
+
+	// 描画する球と変形させた球、床と柱の位置・回転・拡大率
+	static constexpr std::uint32_t groundIndex(drawCount + 1), pillarIndex(drawCount + 2);
+	TransformStore transforms(drawCount + 3);
+	for (int i = 0; i < drawCount + 3; ++i) transforms.create();
+	transforms.setPosition(groundIndex, 0.0f, -2.0f, 0.0f);
+	transforms.setScale(groundIndex, 6.0f, 1.0f, 6.0f);
+	transforms.setPosition(pillarIndex, 0.0f, -1.6f, 0.0f);
+	transforms.setScale(pillarIndex, 0.4f, 0.4f, 0.4f);
+
+	// 描画したフレーム数
+	unsigned long long frameCount(0);
 
 	// タイマーを0に設定
 	glfwSetTime(0.0);
@@ -157,15 +270,36 @@ int main() {
 	// メインループ
 	while (window.shoudClose() == GL_FALSE)
 	{
-		// ウィンドウを消去
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		// シェーダプログラムを使用する
-		glUseProgram(program);
+		// このフレームのヒープ確保の回数を数える
+		const AllocationScope allocations;
+
+		// 読み込みが終わったリソースを受け取る（受け取ったフレームは図形を作るのでヒープを確保してよい）
+		const bool loaded(loader.update(manager) > 0);
+
+		// このフレームの一時バッファをGPUが読み終わるのを待つ
+		FrameContext& frame(frames.begin());
+		Telemetry::set(Telemetry::STALL_TIME, frames.getStallTime());
+
+		// このフレームの一時データをまとめて確保する
+		DrawItem* const draws(frameArena.allocate<DrawItem>(drawCount));
+		GLfloat* const modelViews(frameArena.allocate<GLfloat>(16 * transforms.getCount()));
+		GLfloat* const normalMatrices(frameArena.allocate<GLfloat>(12 * transforms.getCount()));
+		Transform* const transform(frameArena.allocate<Transform>());
+		GLfloat* const casters(frameArena.allocate<GLfloat>(16 * transforms.getCount()));
+		Object::Vertex* const deformedCopy(frameArena.allocate<Object::Vertex>(SolidSphere::vertexCount));
+		if (draws == nullptr || modelViews == nullptr || normalMatrices == nullptr || transform == nullptr || casters == nullptr
+			|| deformedCopy == nullptr) {
+			// 足りなければ容量を倍にして、このフレームは描かずに次のフレームから確保し直す
+			std::cerr << "Error: Frame arena exhausted (" << frameArena.getCapacity() << " bytes), skipping frame "
+				<< frameCount << "." << std::endl;
+			frameArena.reserve(frameArena.getCapacity() * 2);
+			frames.end();
+			continue;
+		}
 
 		// 透視投影変換行列を求める
-
 		const GLfloat* const size(window.getSize());
+
 		// const GLfloat scale(window.getScaleWorldToDev() * 2.0f);
 		// const GLfloat w(size[0] / scale), h(size[1] / scale);
 		// 直行投影変換行列
@@ -184,10 +318,22 @@ int main() {
 		const GLfloat aspect(size[0] / size[1]);
 		const Matrix projection(Matrix::perspective(fovy, aspect, 1.0f, 10.0f));
 
-		// モデル変換行列を求める
+		// 止めていなければ球を動かす時間を進める
+		const bool pauseChanged(window.isKeyPressed(GLFW_KEY_P) && !pauseKey);
+		if (pauseChanged) paused = !paused;
+		pauseKey = window.isKeyPressed(GLFW_KEY_P);
+		const double now(glfwGetTime());
+		if (!paused) sceneTime += static_cast<GLfloat>(now - lastTime);
+		lastTime = now;
+
+		// 球を同じ角度だけ回し、2つ目と変形させた球は回した z 軸上の前後に置く
 		const GLfloat* const location(window.getLocation());
-		const Matrix r(Matrix::rotate(static_cast<GLfloat>(glfwGetTime()), 0.0f, 1.0f, 0.0f));
-		const Matrix model(Matrix::translate(location[0], location[1], 0.0f) * r);
+		const GLfloat angle(sceneTime);
+		const GLfloat dx(2.5f * sin(angle)), dz(2.5f * cos(angle));
+		transforms.setPosition(0, location[0], location[1], 0.0f);
+		transforms.setPosition(1, location[0] + dx, location[1], dz);
+		transforms.setPosition(2, location[0] - dx, location[1], -dz);
+		for (std::uint32_t i = 0; i < drawCount + 1; ++i) transforms.setAxisAngle(i, angle, 0.0f, 1.0f, 0.0f);
 
 		// ビュー変換行列を求める
 		const Matrix view(Matrix::lookat(
@@ -196,41 +342,205 @@ int main() {
 			0.0f, 1.0f, 0.0f		// 上方向のベクトル
 		));
 
-		// 法線ベクトル変換行列の格納先
-		GLfloat normalMatrix[9];
+		// 読み込みが終わっていれば細かく分割した球を描く
+		const Shape* const shape(detailShapePtr ? detailShapePtr.get() : shapePtr.get());
+
+		// 球を変形させて頂点バッファに送る
+		//   マップするときはリングの次の領域に直接書き込む（この領域を読んだフレームのフェンスは待ち済み）
+		//   書き込めなかったときは領域の内容が古いか不定なので、代わりに変形させていない球を描く
+		//   ほかの方法では一時領域で変形させてから描画に使う領域に転送する
+		if (window.isKeyPressed(GLFW_KEY_M) && !streamingKey) streaming = (streaming + 1) % STREAM_COUNT;
+		streamingKey = window.isKeyPressed(GLFW_KEY_M);
+		bool animated(false);
+		if (streaming == STREAM_MAP) {
+			Object::Vertex* const deformed(animatedSphere.map());
+			if (deformed != nullptr) {
+				deformSphere(SolidSphere::vertexCount, SolidSphere::vertex.data(), sceneTime, deformed);
+				animated = animatedSphere.unmap();
+			}
+		}
+		else {
+			deformSphere(SolidSphere::vertexCount, SolidSphere::vertex.data(), sceneTime, deformedCopy);
+			if (streaming == STREAM_SUB_DATA) {
+				animatedSphere.update(0, SolidSphere::vertexCount, deformedCopy);
+			}
+			else {
+				animatedSphere.orphan(deformedCopy);
+			}
+			animated = true;
+		}
+
+		// 止めたか再開したとき、止めている間に球を動かしたか差し替えたときは静的な物体が変わった
+		const bool moved(location[0] != lastLocation[0] || location[1] != lastLocation[1]);
+		std::copy(location, location + 2, lastLocation);
+		if (pauseChanged || (paused && (moved || loaded))) shadow.invalidate();
+
+		// 光源から見たデプスマップを描く
+		//   柱はキャッシュを描き直すときだけ、動く球は毎フレーム重ねて描く
+		//   止めている間は球もキャッシュに描くので、キャッシュを描き直さない限りデプスマップは描かない
+		const auto castSpheres([&](int light) {
+			transforms.compose(shadow.getLightMatrix(light), 0, drawCount + 1, casters);
+			for (int i = 0; i < drawCount; ++i) {
+				shadow.cast(casters + 16 * i);
+				shape->draw();
+			}
+			shadow.cast(casters + 16 * drawCount);
+			if (animated) animatedSphere.draw(); else shapePtr->draw();
+		});
+		for (int i = 0; i < Lcount; ++i) shadow.setLight(i, Lpos[i].data(), Ltarget);
+		shadow.render(
+			[&](int light) {
+				transforms.compose(shadow.getLightMatrix(light), pillarIndex, 1, casters);
+				shadow.cast(casters + 16 * pillarIndex);
+				pillarPtr->draw();
+				if (paused) castSpheres(light);
+			},
+			castSpheres, !paused);
+
+		// シーンはウィンドウより小さいかもしれないフレームバッファオブジェクトに描く
+		resolution.begin(static_cast<GLsizei>(size[0]), static_cast<GLsizei>(size[1]));
+		Telemetry::set(Telemetry::RESOLUTION_SCALE, resolution.getScale());
+		Telemetry::set(Telemetry::SCENE_GPU_TIME, resolution.getGpuTime());
+
+		// ウィンドウを消去
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		// シェーダプログラムを使用する
+		glUseProgram(program);
+		Telemetry::add(Telemetry::PROGRAM_BINDS);
+
+		// モデルビュー変換行列と法線変換行列をまとめて求める
+		transforms.compose(view, modelViews, normalMatrices);
 
-		// モデルビュー変換行列を求める
-		const Matrix modelView(view * model);
+		// このフレームの描画リストを一時領域に作る（1つ目の球は遮蔽物にも使う）
+		draws[0] = { shape, &material[0], Matrix(modelViews), 0, true };
+		draws[1] = { shape, &material[1], Matrix(modelViews + 16), 0, false };
 
-		// 法線ベクトル変換行列を求める
-		modelView.getNormalMatrix(normalMatrix);
+		// uniform blockに格納する変換行列
+		std::copy(projection.data(), projection.data() + 16, transform->projection.begin());
+
+		for (int i = 0; i < drawCount; ++i) {
+			// 変換行列をこのフレームの一時バッファに書き込む
+			draws[i].transform = pushTransform(frame, frames.getAlignment(), modelViews + 16 * i, normalMatrices + 12 * i, *transform);
+		}
+
+		// 遮蔽物をCPUのデプスバッファに描く（粗い球は細かい球の内側にあるので遮蔽物に使える）
+		culler.clear();
+		for (int i = 0; i < drawCount; ++i) {
+			if (!draws[i].occluder) continue;
+			culler.addOccluder(projection * draws[i].modelView,
+				SolidSphere::vertexCount, SolidSphere::vertex.data(),
+				SolidSphere::indexCount, SolidSphere::index.data());
+		}
+		culler.rasterize();
 
-		// uniform変数に変換行列を設定
-		glUniformMatrix4fv(modelViewLocation, 1, GL_FALSE, modelView.data());
-		glUniformMatrix4fv(projectionLocation, 1, GL_FALSE, projection.data());
-		glUniformMatrix3fv(normalMatrixLocation, 1, GL_FALSE, normalMatrix);
 		for (int i = 0; i < Lcount; ++i) {
 			glUniform4fv(LposLocation + i, 1, (view * Lpos[i]).data());
 		}
 		glUniform3fv(LambLocation, Lcount, Lamb);
 		glUniform3fv(LdiffLocation, Lcount, Ldiff);
 		glUniform3fv(LspecLocation, Lcount, Lspec);
+		Telemetry::add(Telemetry::UNIFORM_BYTES, Lcount * 4 * sizeof(GLfloat) + sizeof Lamb + sizeof Ldiff + sizeof Lspec);
+
+		// 視点座標系からシャドウマップのテクスチャ座標への変換行列
+		GLfloat shadowMatrix[Lcount][16];
+		for (int i = 0; i < Lcount; ++i) {
+			const Matrix m(shadow.getShadowMatrix(i, view));
+			std::copy(m.data(), m.data() + 16, shadowMatrix[i]);
+		}
+		glUniformMatrix4fv(shadowMatrixLocation, Lcount, GL_FALSE, shadowMatrix[0]);
+		Telemetry::add(Telemetry::UNIFORM_BYTES, sizeof shadowMatrix);
+		shadow.bind(shadowUnit);
+
 		// ここで描画処理
-		material[0].select();
-		shapePtr->draw();
-		
-		// 2つ目のモデルビュー行列を作成
-		const Matrix modelView1(modelView * Matrix::translate(0.0f, 0.0f, 2.5f));
-
-		// 2つめの法線ベクトル変換行列を求める
-		modelView1.getNormalMatrix(normalMatrix);
-
-		glUniformMatrix4fv(modelViewLocation, 1, GL_FALSE, modelView1.data());
-		glUniformMatrix3fv(normalMatrixLocation, 1, GL_FALSE, normalMatrix);
-		
-		// 2つめのShapeの描画
-		material[1].select();
-		shapePtr->draw();
+		for (int i = 0; i < drawCount; ++i) {
+			// 遮蔽物に隠れている図形は描かない
+			if (!draws[i].occluder && !culler.isVisible(projection * draws[i].modelView, sphereMin, sphereMax)) continue;
+
+			// 一時バッファに書き込めなかった図形は描かない
+			if (draws[i].transform < 0) continue;
+
+			frame.select(1, draws[i].transform, sizeof(Transform));
+			draws[i].material->select();
+			draws[i].shape->draw();
+		}
+
+		// 床と柱を描く
+		material[2].select();
+		const GLintptr groundTransform(pushTransform(frame, frames.getAlignment(),
+			modelViews + 16 * groundIndex, normalMatrices + 12 * groundIndex, *transform));
+		if (groundTransform >= 0) {
+			frame.select(1, groundTransform, sizeof(Transform));
+			groundPtr->draw();
+		}
+		const GLintptr pillarTransform(pushTransform(frame, frames.getAlignment(),
+			modelViews + 16 * pillarIndex, normalMatrices + 12 * pillarIndex, *transform));
+		if (pillarTransform >= 0) {
+			frame.select(1, pillarTransform, sizeof(Transform));
+			pillarPtr->draw();
+		}
+
+		// 変形させた球を1つ目の球の反対側に描く
+		const Matrix animatedModelView(modelViews + 16 * drawCount);
+		if (culler.isVisible(projection * animatedModelView, sphereMin, sphereMax)) {
+			const GLintptr animatedTransform(pushTransform(frame, frames.getAlignment(),
+				modelViews + 16 * drawCount, normalMatrices + 12 * drawCount, *transform));
+			if (animatedTransform >= 0) {
+				frame.select(1, animatedTransform, sizeof(Transform));
+				material[0].select();
+				if (animated) animatedSphere.draw(); else shapePtr->draw();
+			}
+		}
+
+		// 1つ目の球の変換行列で周りの小さな球をまとめて描く
+		glUseProgram(procedural);
+		Telemetry::add(Telemetry::PROGRAM_BINDS);
+		for (int i = 0; i < Lcount; ++i) {
+			glUniform4fv(proceduralLposLocation + i, 1, (view * Lpos[i]).data());
+		}
+		glUniform3fv(proceduralLambLocation, Lcount, Lamb);
+		glUniform3fv(proceduralLdiffLocation, Lcount, Ldiff);
+		glUniform3fv(proceduralLspecLocation, Lcount, Lspec);
+		glUniformMatrix4fv(proceduralShadowMatrixLocation, Lcount, GL_FALSE, shadowMatrix[0]);
+		Telemetry::add(Telemetry::UNIFORM_BYTES, Lcount * 4 * sizeof(GLfloat) + sizeof Lamb + sizeof Ldiff + sizeof Lspec + sizeof shadowMatrix);
+		if (draws[0].transform >= 0) {
+			frame.select(1, draws[0].transform, sizeof(Transform));
+			material[1].select();
+			satellites.draw();
+		}
+
+		// シーンをウィンドウの大きさに拡大して表示する
+		resolution.end();
+
+		// このフレームの一時データを捨てる
+		frameArena.reset();
+
+		// キャプチャ中ならこのフレームの読み出しを始める
+		if (window.isKeyPressed(GLFW_KEY_F12) && !captureKey) capturing = !capturing;
+		captureKey = window.isKeyPressed(GLFW_KEY_F12);
+		if (capturing) {
+			capture.capture(static_cast<GLsizei>(size[0]), static_cast<GLsizei>(size[1]), frameCount);
+			Telemetry::set(Telemetry::CAPTURE_TIME, capture.getCaptureTime());
+		}
+
+		// このフレームの描画命令の後ろにフェンスを置く
+		frames.end();
+
+		// GPUが使い終わったリソースを破棄する
+		manager.collect();
+
+		// 定常状態のフレームではヒープを確保しない
+		if (++frameCount > static_cast<unsigned long long>(frames.getCount()) && !loaded && allocations.getCount() > 0) {
+			std::cerr << "Warning: " << allocations.getCount() << " heap allocations in frame " << frameCount << std::endl;
+		}
+
+		// このフレームの計測値を締めて、ときどきタイトルに表示する
+		stats.endFrame();
+		if (stats.getFrameCount() % 60 == 0) {
+			char title[128];
+			stats.format(title, sizeof title);
+			window.setTitle(title);
+		}
 
 		window.swapBuffers();
 	}
@@ -386,3 +696,42 @@ GLuint loadProgram(const char* vert, const char* frag)
 	// プログラムオブジェクトを作る
 	return vstat && fstat ? createProgram(vsrc.data(), fsrc.data()) : 0;
 }
+
+/// <summary>
+/// 球の頂点を法線方向に波打たせる
+/// </summary>
+/// <param name="count">頂点数</param>
+/// <param name="base">変形前の球の頂点属性</param>
+/// <param name="time">経過時間</param>
+/// <param name="vertex">変形後の頂点属性の格納先</param>
+void deformSphere(GLsizei count, const Object::Vertex* base, GLfloat time, Object::Vertex* vertex)
+{
+	for (GLsizei i = 0; i < count; ++i) {
+		const Object::Vertex& v(base[i]);
+
+		// 緯度に沿って進む波の高さだけ法線方向に動かす（法線は元の球のものを使う）
+		const GLfloat d(1.0f + 0.1f * sin(8.0f * v.position[1] + 3.0f * time));
+		vertex[i] = {
+			v.position[0] * d, v.position[1] * d, v.position[2] * d,
+			v.normal[0], v.normal[1], v.normal[2]
+		};
+	}
+}
+
+/// <summary>
+/// 変換行列をフレームの一時バッファに書き込む
+/// </summary>
+/// <param name="frame">書き込むフレーム</param>
+/// <param name="alignment">書き込み位置の境界</param>
+/// <param name="modelView">モデルビュー変換行列（16要素）</param>
+/// <param name="normalMatrix">std140 の mat3 に揃えた法線変換行列（12要素）</param>
+/// <param name="transform">書き込むデータを組み立てる領域（投影変換行列は設定済み）</param>
+/// <returns>書き込んだ位置（一時バッファの容量が足りなければ -1）</returns>
+GLintptr pushTransform(FrameContext& frame, GLintptr alignment, const GLfloat* modelView, const GLfloat* normalMatrix, Transform& transform)
+{
+	// TransformStore::compose() が求めた行列をそのまま並べる
+	std::copy(modelView, modelView + 16, transform.modelView.begin());
+	std::copy(normalMatrix, normalMatrix + 12, transform.normalMatrix.begin());
+
+	return frame.push(&transform, sizeof(Transform), alignment);
+}
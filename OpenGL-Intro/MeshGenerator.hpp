@@ -0,0 +1,223 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include <GL/glew.h>
+#include "Object.hpp"
+
+//
+// コンパイル時に評価できる三角関数
+//   std::sin / std::cos は constexpr ではないので、範囲を縮めてからテイラー展開で求める
+//
+namespace MeshMath {
+	constexpr double pi = 3.14159265358979323846;
+
+	// [-π, π] に収めた角度の正弦
+	constexpr double sinReduced(double x) {
+		const double x2(x * x);
+		double term(x), sum(x);
+		for (int n = 1; n < 12; ++n) {
+			term *= -x2 / ((2 * n) * (2 * n + 1));
+			sum += term;
+		}
+		return sum;
+	}
+
+	constexpr double reduce(double x) {
+		const long long k(static_cast<long long>(x / (2.0 * pi) + (x >= 0.0 ? 0.5 : -0.5)));
+		return x - k * 2.0 * pi;
+	}
+
+	constexpr float sin(double x) { return static_cast<float>(sinReduced(reduce(x))); }
+	constexpr float cos(double x) { return static_cast<float>(sinReduced(reduce(x + 0.5 * pi))); }
+}
+
+//
+// Slices x Stacks に分割した半径 1 の球
+//   頂点と頂点インデックスは constexpr の配列なので、ヒープを使わずに読み出し専用の領域に置かれる
+//
+template <int Slices, int Stacks>
+struct SphereMesh {
+	static_assert(Slices >= 3 && Stacks >= 2, "SphereMesh needs at least 3 slices and 2 stacks.");
+
+	static constexpr GLsizei vertexCount = (Slices + 1) * (Stacks + 1);
+	static constexpr GLsizei indexCount = Slices * Stacks * 6;
+
+	static constexpr std::array<Object::Vertex, vertexCount> makeVertex() {
+		std::array<Object::Vertex, vertexCount> v{};
+		for (int j = 0; j <= Stacks; ++j) {
+			const double t(static_cast<double>(j) / Stacks);
+			const float y(MeshMath::cos(MeshMath::pi * t)), r(MeshMath::sin(MeshMath::pi * t));
+			for (int i = 0; i <= Slices; ++i) {
+				const double s(static_cast<double>(i) / Slices);
+				const float z(r * MeshMath::cos(2.0 * MeshMath::pi * s)), x(r * MeshMath::sin(2.0 * MeshMath::pi * s));
+				v[j * (Slices + 1) + i] = { { x, y, z }, { x, y, z } };
+			}
+		}
+		return v;
+	}
+
+	static constexpr std::array<GLuint, indexCount> makeIndex() {
+		std::array<GLuint, indexCount> index{};
+		int n(0);
+		for (int j = 0; j < Stacks; ++j) {
+			const int k((Slices + 1) * j);
+			for (int i = 0; i < Slices; ++i) {
+				const GLuint k0(k + i);
+				const GLuint k1(k0 + 1);
+				const GLuint k2(k1 + Slices);
+				const GLuint k3(k2 + 1);
+
+				// 左下の三角形のインデックス
+				index[n++] = k0; index[n++] = k2; index[n++] = k3;
+				// 左上の三角形のインデックス
+				index[n++] = k0; index[n++] = k3; index[n++] = k1;
+			}
+		}
+		return index;
+	}
+
+	static constexpr std::array<Object::Vertex, vertexCount> vertex = makeVertex();
+	static constexpr std::array<GLuint, indexCount> index = makeIndex();
+};
+
+//
+// 一辺の長さ 2 の六面体（面ごとに法線の異なる 36 頂点）
+//   左・裏・下・右・上・前の順に各面 2 つの三角形を並べる
+//
+struct CubeMesh {
+	static constexpr GLsizei vertexCount = 36;
+	static constexpr GLsizei indexCount = 36;
+
+	static constexpr std::array<Object::Vertex, vertexCount> makeVertex() {
+		// 面の法線と、法線 = u x v となる面内の2軸
+		constexpr float face[6][3][3] = {
+			{ { -1,  0,  0 }, {  0,  0,  1 }, {  0,  1,  0 } }, // 左
+			{ {  0,  0, -1 }, { -1,  0,  0 }, {  0,  1,  0 } }, // 裏
+			{ {  0, -1,  0 }, {  1,  0,  0 }, {  0,  0,  1 } }, // 下
+			{ {  1,  0,  0 }, {  0,  0, -1 }, {  0,  1,  0 } }, // 右
+			{ {  0,  1,  0 }, {  1,  0,  0 }, {  0,  0, -1 } }, // 上
+			{ {  0,  0,  1 }, {  1,  0,  0 }, {  0,  1,  0 } }  // 前
+		};
+
+		// 面内の2つの三角形の頂点（u, v の係数）
+		constexpr float corner[6][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, -1 }, { 1, 1 }, { -1, 1 } };
+
+		std::array<Object::Vertex, vertexCount> v{};
+		for (int f = 0; f < 6; ++f) {
+			const float* const n(face[f][0]);
+			const float* const u(face[f][1]);
+			const float* const w(face[f][2]);
+			for (int c = 0; c < 6; ++c) {
+				Object::Vertex& p(v[f * 6 + c]);
+				for (int k = 0; k < 3; ++k) {
+					p.position[k] = n[k] + corner[c][0] * u[k] + corner[c][1] * w[k];
+					p.normal[k] = n[k];
+				}
+			}
+		}
+		return v;
+	}
+
+	static constexpr std::array<GLuint, indexCount> makeIndex() {
+		std::array<GLuint, indexCount> index{};
+		for (int i = 0; i < indexCount; ++i) index[i] = i;
+		return index;
+	}
+
+	// テンプレートでないクラスの中ではメンバ関数を定数式に使えないので、定義はクラスの外に置く
+	static const std::array<Object::Vertex, vertexCount> vertex;
+	static const std::array<GLuint, indexCount> index;
+};
+
+inline constexpr std::array<Object::Vertex, CubeMesh::vertexCount> CubeMesh::vertex = CubeMesh::makeVertex();
+inline constexpr std::array<GLuint, CubeMesh::indexCount> CubeMesh::index = CubeMesh::makeIndex();
+
+//
+// xz 平面上の [-1, 1] x [-1, 1] を N x N に分割した平面（法線は +y）
+//
+template <int N>
+struct PlaneMesh {
+	static_assert(N >= 1, "PlaneMesh needs at least 1 division.");
+
+	static constexpr GLsizei vertexCount = (N + 1) * (N + 1);
+	static constexpr GLsizei indexCount = N * N * 6;
+
+	static constexpr std::array<Object::Vertex, vertexCount> makeVertex() {
+		std::array<Object::Vertex, vertexCount> v{};
+		for (int j = 0; j <= N; ++j) {
+			const float z(2.0f * j / N - 1.0f);
+			for (int i = 0; i <= N; ++i) {
+				const float x(2.0f * i / N - 1.0f);
+				v[j * (N + 1) + i] = { { x, 0.0f, z }, { 0.0f, 1.0f, 0.0f } };
+			}
+		}
+		return v;
+	}
+
+	static constexpr std::array<GLuint, indexCount> makeIndex() {
+		std::array<GLuint, indexCount> index{};
+		int n(0);
+		for (int j = 0; j < N; ++j) {
+			for (int i = 0; i < N; ++i) {
+				const GLuint k00(j * (N + 1) + i), k10(k00 + 1);
+				const GLuint k01(k00 + N + 1), k11(k01 + 1);
+
+				// 上から見て反時計回り
+				index[n++] = k00; index[n++] = k01; index[n++] = k11;
+				index[n++] = k00; index[n++] = k11; index[n++] = k10;
+			}
+		}
+		return index;
+	}
+
+	static constexpr std::array<Object::Vertex, vertexCount> vertex = makeVertex();
+	static constexpr std::array<GLuint, indexCount> index = makeIndex();
+};
+
+//
+// 分割数を実行時に決める球の生成
+//   SphereMesh と同じ並びの頂点を作る。分割数が大きいときは threads 個のスレッドで緯度方向に分担する
+//
+inline void generateSphere(int slices, int stacks, std::vector<Object::Vertex>& vertex, std::vector<GLuint>& index, int threads = 1)
+{
+	vertex.resize(static_cast<std::size_t>(slices + 1) * (stacks + 1));
+	index.resize(static_cast<std::size_t>(slices) * stacks * 6);
+
+	// 緯度 first, first + step, ... の頂点とインデックスを作る
+	const auto rows = [&](int first, int step) {
+		for (int j = first; j <= stacks; j += step) {
+			const float t(static_cast<float>(j) / static_cast<float>(stacks));
+			const float y(std::cos(3.141593f * t)), r(std::sin(3.141593f * t));
+			for (int i = 0; i <= slices; ++i) {
+				const float s(static_cast<float>(i) / static_cast<float>(slices));
+				const float z(r * std::cos(6.283185f * s)), x(r * std::sin(6.283185f * s));
+				vertex[static_cast<std::size_t>(j) * (slices + 1) + i] = { { x, y, z }, { x, y, z } };
+			}
+
+			if (j == stacks) break;
+			GLuint* p(&index[static_cast<std::size_t>(j) * slices * 6]);
+			const int k((slices + 1) * j);
+			for (int i = 0; i < slices; ++i) {
+				const GLuint k0(k + i);
+				const GLuint k1(k0 + 1);
+				const GLuint k2(k1 + slices);
+				const GLuint k3(k2 + 1);
+
+				*p++ = k0; *p++ = k2; *p++ = k3;
+				*p++ = k0; *p++ = k3; *p++ = k1;
+			}
+		}
+	};
+
+	if (threads > 1) {
+		std::vector<std::thread> workers;
+		for (int i = 1; i < threads; ++i) workers.emplace_back(rows, i, threads);
+		rows(0, threads);
+		for (std::thread& worker : workers) worker.join();
+	}
+	else {
+		rows(0, 1);
+	}
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <GL/glew.h>
+#include "Telemetry.hpp"
 
 class Object {
 private:
@@ -15,6 +16,20 @@ private:
 	Object(const Object& o) = delete;
 	Object& operator=(const Object& rhs) = delete;
 
+	// 結合中の頂点配列オブジェクトにバッファオブジェクトを組み込む
+	void attach(GLint size) {
+		glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+
+		// 結合済みの頂点バッファオブジェクトをシェーダのin変数から参照できるようにする
+		glVertexAttribPointer(0, size, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), static_cast<char*>(0) + sizeof(Vertex::position));
+		glEnableVertexAttribArray(1);
+
+		// 頂点インデックスバッファオブジェクトを結合する
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ibo);
+	}
+
 public:
 	// 頂点属性
 	struct Vertex {
@@ -32,28 +47,45 @@ public:
 		glBindBuffer(GL_ARRAY_BUFFER, _vbo);
 		glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), vertex, GL_STATIC_DRAW);
 
-		// 結合済みの頂点バッファオブジェクトをシェーダのin変数から参照できるようにする
-		glVertexAttribPointer(0, size, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0);
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), static_cast<char*>(0) + sizeof(vertex->position));
-		glEnableVertexAttribArray(1);
-
 		// 頂点インデックスバッファオブジェクト作成
 		glGenBuffers(1, &_ibo);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ibo);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(GLuint), index, GL_STATIC_DRAW);
+
+		attach(size);
+	}
+
+	// 別のコンテキストで作成済みのバッファオブジェクトから作成する
+	//   頂点配列オブジェクトはコンテキスト間で共有できないので、ここで作る
+	Object(GLint size, GLuint vbo, GLuint ibo)
+		: _vbo(vbo)
+		, _ibo(ibo)
+	{
+		glGenVertexArrays(1, &_vao);
+		glBindVertexArray(_vao);
+		attach(size);
+	}
+
+	// バッファオブジェクトを持たない空の頂点配列オブジェクトを作成する
+	//   頂点属性を使わずに gl_VertexID から頂点を作るシェーダで描くときに使う
+	Object()
+		: _vbo(0)
+		, _ibo(0)
+	{
+		glGenVertexArrays(1, &_vao);
 	}
 
 	virtual ~Object() {
 		// 頂点配列オブジェクトを削除
-		glDeleteBuffers(1, &_vbo);
+		glDeleteVertexArrays(1, &_vao);
 		// 頂点バッファオブジェクトを削除
-		glDeleteBuffers(1, &_vao);
+		glDeleteBuffers(1, &_vbo);
 		// 頂点インデックスバッファオブジェクト削除
 		glDeleteBuffers(1, &_ibo);
 	}
 
 	void bind() const {
 		glBindVertexArray(_vao);
+		Telemetry::add(Telemetry::VAO_BINDS);
 	}
 };
\ No newline at end of file
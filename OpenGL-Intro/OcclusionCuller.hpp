@@ -0,0 +1,438 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Matrix.hpp"
+#include "Object.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OCCLUSION_CULLER_SSE2
+#endif
+
+//
+// CPU によるソフトウェア遮蔽カリング
+//   遮蔽物のメッシュを低解像度のデプスバッファにタイルごとに描き、
+//   階層デプス（Hi-Z）でインスタンスの境界ボックスが隠れているかを調べる
+//   GL の関数は呼ばないので GPU なしでテストやベンチマークができる
+//   辺関数は固定小数点で求め、左上ルールで共有する辺の画素をどちらか一方の三角形だけに割り当てる
+//
+class OcclusionCuller {
+private:
+	// タイルの大きさ（幅は SIMD の4画素の倍数）
+	static constexpr int TILE_WIDTH = 32;
+	static constexpr int TILE_HEIGHT = 16;
+
+	// これより w が小さい頂点はニアクリップ面の手前とみなす
+	static constexpr float NEAR_W = 1.0e-5f;
+
+	// 頂点の座標の小数部のビット数（1画素を 16 に分ける）
+	static constexpr int SUBPIXEL_BITS = 4;
+	static constexpr int SUBPIXEL = 1 << SUBPIXEL_BITS;
+
+	// 画面の外にこれより大きくはみ出す三角形は遮蔽物に使わない（固定小数点の辺関数が 64 ビットに収まり、
+	// タイルの1行の中で 32 ビットに収まるようにする）
+	static constexpr float GUARD_BAND = 8192.0f;
+
+	// SIMD で辺関数を 32 ビットで扱うときに値を丸める範囲（タイルの1行の中で符号が変わらない大きさ）
+	static constexpr std::int64_t EDGE_CLAMP = std::int64_t(1) << 30;
+
+	// スクリーン座標に変換した三角形（x, y は固定小数点）
+	struct Triangle {
+		std::int32_t x[3], y[3];
+		float z[3];
+	};
+
+	// 固定小数点の座標を画素の番号にする（負の数も切り下げる）
+	static int toPixel(std::int32_t v) {
+		return v >= 0 ? v >> SUBPIXEL_BITS : -((-v + SUBPIXEL - 1) >> SUBPIXEL_BITS);
+	}
+
+	// デプスバッファの大きさ
+	const int _width, _height;
+
+	// タイルの数
+	const int _tilesX, _tilesY;
+
+	// タイルの処理に使うスレッド数
+	const int _threads;
+
+	// Hi-Z の各レベル（レベル 0 がデプスバッファ、各画素は覆う範囲の最も遠いデプス）
+	std::vector<std::vector<float>> _levels;
+	std::vector<int> _levelWidth, _levelHeight;
+
+	// 遮蔽物の三角形
+	std::vector<Triangle> _triangles;
+
+	// タイルごとに振り分けた三角形の番号
+	std::vector<std::vector<std::uint32_t>> _bins;
+
+	// 遮蔽物の頂点をクリップ座標系に変換したもの
+	std::vector<float> _clip;
+
+	// タイルを分担する常駐スレッド（threads - 1 個、rasterize() を呼んだスレッドも1つ分を受け持つ）
+	//   毎フレームスレッドを作ると生成の時間とヒープの確保が描画スレッドにかかるので、作成時に起動しておく
+	std::vector<std::thread> _workers;
+
+	// 常駐スレッドを起こして終わりを待つための同期
+	std::mutex _mutex;
+	std::condition_variable _start, _finish;
+
+	// rasterize() の回数（常駐スレッドはこれが変わると描き始める）
+	std::uint64_t _round;
+
+	// この回のタイルを描き終えていない常駐スレッドの数
+	int _pending;
+
+	// 常駐スレッドを続けるかどうか
+	bool _running;
+
+	// UnCopiable
+	OcclusionCuller(const OcclusionCuller& o) = delete;
+	OcclusionCuller& operator=(const OcclusionCuller& rhs) = delete;
+
+	// 常駐スレッドの処理
+	//   index: 受け持つタイルの最初の番号
+	void work(int index) {
+		std::uint64_t round(0);
+		for (;;) {
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_start.wait(lock, [&] { return !_running || _round != round; });
+				if (!_running) return;
+				round = _round;
+			}
+
+			rasterizeTiles(index, _threads);
+
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (--_pending == 0) _finish.notify_one();
+		}
+	}
+
+	// クリップ座標系の点をスクリーン座標に変換する
+	void toScreen(const float* c, float& x, float& y, float& z) const {
+		const float iw(1.0f / c[3]);
+		x = (c[0] * iw * 0.5f + 0.5f) * _width;
+		y = (c[1] * iw * 0.5f + 0.5f) * _height;
+		z = c[2] * iw * 0.5f + 0.5f;
+	}
+
+	// 点 (x, y, z, 1) を変換する
+	static void transform(const GLfloat* m, float x, float y, float z, float* c) {
+		for (int i = 0; i < 4; ++i) c[i] = m[i] * x + m[4 + i] * y + m[8 + i] * z + m[12 + i];
+	}
+
+	// 三角形をタイルの範囲 [tx0, tx1) x [ty0, ty1) に描く
+	//   画素の中心 (px + 0.5, py + 0.5) が三角形の内側か、左上の辺の上にあれば描く
+	void rasterize(const Triangle& t, int tx0, int ty0, int tx1, int ty1) {
+		// 反時計回りにそろえる（整数で求めるので共有する辺の辺関数は符号が逆なだけで同じ値になる）
+		std::int32_t x[3] = { t.x[0], t.x[1], t.x[2] }, y[3] = { t.y[0], t.y[1], t.y[2] };
+		float z[3] = { t.z[0], t.z[1], t.z[2] };
+		std::int64_t area(static_cast<std::int64_t>(x[1] - x[0]) * (y[2] - y[0]) - static_cast<std::int64_t>(x[2] - x[0]) * (y[1] - y[0]));
+		if (area == 0) return;
+		if (area < 0) {
+			std::swap(x[1], x[2]);
+			std::swap(y[1], y[2]);
+			std::swap(z[1], z[2]);
+			area = -area;
+		}
+
+		// 辺 i は頂点 i+1 から i+2 へ向かい、E = A * x + B * y + C が内側で正になる
+		//   左上の辺（A > 0 か、水平で B < 0）以外は E = 0 を外側にするため C から 1 を引いて E >= 0 で判定する
+		std::int64_t A[3], B[3], C[3];
+		for (int i = 0; i < 3; ++i) {
+			const int a((i + 1) % 3), b((i + 2) % 3);
+			A[i] = y[a] - y[b];
+			B[i] = x[b] - x[a];
+			C[i] = static_cast<std::int64_t>(x[a]) * y[b] - static_cast<std::int64_t>(y[a]) * x[b];
+			if (!(A[i] > 0 || (A[i] == 0 && B[i] < 0))) --C[i];
+		}
+
+		// デプスの平面 z = z[0] + zA * (x - x[0]) + zB * (y - y[0])（x, y は固定小数点）
+		const double ia(1.0 / static_cast<double>(area));
+		const float zA(static_cast<float>((A[0] * static_cast<double>(z[0]) + A[1] * static_cast<double>(z[1]) + A[2] * static_cast<double>(z[2])) * ia));
+		const float zB(static_cast<float>((B[0] * static_cast<double>(z[0]) + B[1] * static_cast<double>(z[1]) + B[2] * static_cast<double>(z[2])) * ia));
+
+		// 中心が三角形の境界ボックスに入る画素とタイルが重なる範囲（x は4画素単位にそろえる）
+		const int x0(std::max(tx0, toPixel(std::min({ x[0], x[1], x[2] }) - SUBPIXEL / 2)) & ~3);
+		const int x1(std::min(tx1, toPixel(std::max({ x[0], x[1], x[2] }) - SUBPIXEL / 2) + 1));
+		const int y0(std::max(ty0, toPixel(std::min({ y[0], y[1], y[2] }) - SUBPIXEL / 2)));
+		const int y1(std::min(ty1, toPixel(std::max({ y[0], y[1], y[2] }) - SUBPIXEL / 2) + 1));
+		if (x0 >= x1 || y0 >= y1) return;
+
+		std::vector<float>& depth(_levels[0]);
+
+#if defined(OCCLUSION_CULLER_SSE2)
+		// 1行の辺関数は行の先頭で 64 ビットで求め、丸めてから 32 ビットで1画素ずつ進める
+		const std::int32_t step[] = {
+			static_cast<std::int32_t>(A[0] * SUBPIXEL), static_cast<std::int32_t>(A[1] * SUBPIXEL), static_cast<std::int32_t>(A[2] * SUBPIXEL)
+		};
+		const __m128i minusOne(_mm_set1_epi32(-1));
+		const __m128 offset(_mm_set_ps(3.0f * SUBPIXEL, 2.0f * SUBPIXEL, 1.0f * SUBPIXEL, 0.0f));
+		__m128i edgeStep[3], laneStep[3];
+		for (int i = 0; i < 3; ++i) {
+			edgeStep[i] = _mm_set1_epi32(step[i] * 4);
+			laneStep[i] = _mm_set_epi32(step[i] * 3, step[i] * 2, step[i], 0);
+		}
+
+		for (int py = y0; py < y1; ++py) {
+			const std::int64_t fy(static_cast<std::int64_t>(py) * SUBPIXEL + SUBPIXEL / 2);
+			const std::int64_t fx(static_cast<std::int64_t>(x0) * SUBPIXEL + SUBPIXEL / 2);
+			__m128i e[3];
+			for (int i = 0; i < 3; ++i) {
+				const std::int64_t v(std::max(-EDGE_CLAMP, std::min(EDGE_CLAMP, A[i] * fx + B[i] * fy + C[i])));
+				e[i] = _mm_add_epi32(_mm_set1_epi32(static_cast<std::int32_t>(v)), laneStep[i]);
+			}
+			const __m128 zy(_mm_set1_ps(z[0] + zB * static_cast<float>(fy - y[0])));
+			float* const row(&depth[static_cast<std::size_t>(py) * _width]);
+
+			for (int px = x0; px < x1; px += 4) {
+				const __m128i inside(_mm_and_si128(_mm_cmpgt_epi32(e[0], minusOne),
+					_mm_and_si128(_mm_cmpgt_epi32(e[1], minusOne), _mm_cmpgt_epi32(e[2], minusOne))));
+				for (int i = 0; i < 3; ++i) e[i] = _mm_add_epi32(e[i], edgeStep[i]);
+				const __m128 mask(_mm_castsi128_ps(inside));
+				if (_mm_movemask_ps(mask) == 0) continue;
+
+				const float dx(static_cast<float>(static_cast<std::int64_t>(px) * SUBPIXEL + SUBPIXEL / 2 - x[0]));
+				const __m128 zp(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(zA), _mm_add_ps(_mm_set1_ps(dx), offset)), zy));
+				const __m128 d(_mm_loadu_ps(row + px));
+				const __m128 nd(_mm_min_ps(d, zp));
+				_mm_storeu_ps(row + px, _mm_or_ps(_mm_and_ps(mask, nd), _mm_andnot_ps(mask, d)));
+			}
+		}
+#else
+		for (int py = y0; py < y1; ++py) {
+			const std::int64_t fy(static_cast<std::int64_t>(py) * SUBPIXEL + SUBPIXEL / 2);
+			float* const row(&depth[static_cast<std::size_t>(py) * _width]);
+
+			for (int px = x0; px < x1; ++px) {
+				const std::int64_t fx(static_cast<std::int64_t>(px) * SUBPIXEL + SUBPIXEL / 2);
+				if (A[0] * fx + B[0] * fy + C[0] < 0) continue;
+				if (A[1] * fx + B[1] * fy + C[1] < 0) continue;
+				if (A[2] * fx + B[2] * fy + C[2] < 0) continue;
+
+				const float zp(z[0] + zA * static_cast<float>(fx - x[0]) + zB * static_cast<float>(fy - y[0]));
+				if (zp < row[px]) row[px] = zp;
+			}
+		}
+#endif
+	}
+
+	// タイル first, first + step, ... を描く
+	void rasterizeTiles(int first, int step) {
+		for (int tile = first; tile < _tilesX * _tilesY; tile += step) {
+			const int tx0((tile % _tilesX) * TILE_WIDTH), ty0((tile / _tilesX) * TILE_HEIGHT);
+			const int tx1(std::min(_width, tx0 + TILE_WIDTH)), ty1(std::min(_height, ty0 + TILE_HEIGHT));
+
+			for (const std::uint32_t i : _bins[tile]) rasterize(_triangles[i], tx0, ty0, tx1, ty1);
+		}
+	}
+
+	// Hi-Z の上のレベルを作る
+	void buildHierarchy() {
+		for (std::size_t level = 1; level < _levels.size(); ++level) {
+			const std::vector<float>& src(_levels[level - 1]);
+			std::vector<float>& dst(_levels[level]);
+			const int sw(_levelWidth[level - 1]), sh(_levelHeight[level - 1]);
+			const int dw(_levelWidth[level]), dh(_levelHeight[level]);
+
+			for (int y = 0; y < dh; ++y) {
+				const int sy0(y * 2), sy1(std::min(sy0 + 1, sh - 1));
+				for (int x = 0; x < dw; ++x) {
+					const int sx0(x * 2), sx1(std::min(sx0 + 1, sw - 1));
+					dst[y * dw + x] = std::max(
+						std::max(src[sy0 * sw + sx0], src[sy0 * sw + sx1]),
+						std::max(src[sy1 * sw + sx0], src[sy1 * sw + sx1]));
+				}
+			}
+		}
+	}
+
+public:
+	// width, height: デプスバッファの大きさ, threads: タイルの処理に使うスレッド数
+	OcclusionCuller(int width = 256, int height = 128, int threads = 1)
+		: _width((std::max(width, 4) + 3) & ~3)
+		, _height(std::max(height, 1))
+		, _tilesX((_width + TILE_WIDTH - 1) / TILE_WIDTH)
+		, _tilesY((_height + TILE_HEIGHT - 1) / TILE_HEIGHT)
+		, _threads(std::max(threads, 1))
+		, _bins(_tilesX * _tilesY)
+		, _round(0)
+		, _pending(0)
+		, _running(true)
+	{
+		// 1x1 になるまで半分ずつにしたレベルを用意する
+		int w(_width), h(_height);
+		for (;;) {
+			_levels.emplace_back(static_cast<std::size_t>(w) * h, 1.0f);
+			_levelWidth.push_back(w);
+			_levelHeight.push_back(h);
+			if (w == 1 && h == 1) break;
+			w = std::max(1, (w + 1) / 2);
+			h = std::max(1, (h + 1) / 2);
+		}
+
+		for (int i = 1; i < _threads; ++i) _workers.emplace_back(&OcclusionCuller::work, this, i);
+	}
+
+	virtual ~OcclusionCuller() {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_running = false;
+		}
+		_start.notify_all();
+		for (std::thread& worker : _workers) worker.join();
+	}
+
+	// デプスバッファを消去して遮蔽物を空にする
+	void clear() {
+		std::fill(_levels[0].begin(), _levels[0].end(), 1.0f);
+		_triangles.clear();
+		for (std::vector<std::uint32_t>& bin : _bins) bin.clear();
+	}
+
+	// 遮蔽物を加える
+	//   modelViewProjection: 遮蔽物のモデル座標からクリップ座標への変換行列
+	void addOccluder(const Matrix& modelViewProjection, GLsizei vertexCount, const Object::Vertex* vertex,
+		GLsizei indexCount, const GLuint* index)
+	{
+		const GLfloat* const m(modelViewProjection.data());
+
+		// 頂点をクリップ座標系に変換する
+		_clip.resize(static_cast<std::size_t>(vertexCount) * 4);
+		for (GLsizei i = 0; i < vertexCount; ++i) {
+			transform(m, vertex[i].position[0], vertex[i].position[1], vertex[i].position[2], &_clip[i * 4]);
+		}
+
+		for (GLsizei i = 0; i + 2 < indexCount; i += 3) {
+			const float* const c[3] = { &_clip[index[i] * 4], &_clip[index[i + 1] * 4], &_clip[index[i + 2] * 4] };
+
+			// ニアクリップ面にかかる三角形は遮蔽物に使わない（隠れていないと判定する側に倒れる）
+			if (c[0][3] < NEAR_W || c[1][3] < NEAR_W || c[2][3] < NEAR_W) continue;
+
+			float x[3], y[3], z[3];
+			for (int k = 0; k < 3; ++k) toScreen(c[k], x[k], y[k], z[k]);
+
+			// 画面の外の三角形は捨てる
+			const float minX(std::min({ x[0], x[1], x[2] })), maxX(std::max({ x[0], x[1], x[2] }));
+			const float minY(std::min({ y[0], y[1], y[2] })), maxY(std::max({ y[0], y[1], y[2] }));
+			if (maxX < 0.0f || maxY < 0.0f || minX >= _width || minY >= _height) continue;
+
+			// ガードバンドからはみ出す三角形は遮蔽物に使わない（隠れていないと判定する側に倒れる）
+			if (minX < -GUARD_BAND || minY < -GUARD_BAND || maxX > _width + GUARD_BAND || maxY > _height + GUARD_BAND) continue;
+
+			// 頂点を固定小数点に丸める（共有する頂点はどの三角形でも同じ値になる）
+			Triangle t;
+			for (int k = 0; k < 3; ++k) {
+				t.x[k] = static_cast<std::int32_t>(std::lround(x[k] * SUBPIXEL));
+				t.y[k] = static_cast<std::int32_t>(std::lround(y[k] * SUBPIXEL));
+				t.z[k] = z[k];
+			}
+
+			// 重なるタイルに振り分ける
+			const std::uint32_t n(static_cast<std::uint32_t>(_triangles.size()));
+			_triangles.push_back(t);
+
+			const int bx0(std::max(0, static_cast<int>(minX) / TILE_WIDTH));
+			const int bx1(std::min(_tilesX - 1, static_cast<int>(maxX) / TILE_WIDTH));
+			const int by0(std::max(0, static_cast<int>(minY) / TILE_HEIGHT));
+			const int by1(std::min(_tilesY - 1, static_cast<int>(maxY) / TILE_HEIGHT));
+			for (int by = by0; by <= by1; ++by) {
+				for (int bx = bx0; bx <= bx1; ++bx) _bins[by * _tilesX + bx].push_back(n);
+			}
+		}
+	}
+
+	// 加えた遮蔽物をデプスバッファに描いて Hi-Z を作る
+	//   タイルへの振り分けは addOccluder() で済んでいるので、ここではタイルの描画だけを分担する
+	void rasterize() {
+		if (!_workers.empty()) {
+			// タイルは互いに重ならないので常駐スレッドと分担する
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_pending = static_cast<int>(_workers.size());
+				++_round;
+			}
+			_start.notify_all();
+			rasterizeTiles(0, _threads);
+
+			std::unique_lock<std::mutex> lock(_mutex);
+			_finish.wait(lock, [this] { return _pending == 0; });
+		}
+		else {
+			rasterizeTiles(0, 1);
+		}
+
+		buildHierarchy();
+	}
+
+	// 境界ボックスが遮蔽物に隠れていないか調べる
+	//   modelViewProjection: ボックスのモデル座標からクリップ座標への変換行列
+	//   min, max: モデル座標系の境界ボックス
+	//   戻り値: 見えている可能性があれば true
+	bool isVisible(const Matrix& modelViewProjection, const GLfloat* min, const GLfloat* max) const {
+		const GLfloat* const m(modelViewProjection.data());
+
+		const float inf(std::numeric_limits<float>::infinity());
+		float minX(inf), maxX(-inf);
+		float minY(inf), maxY(-inf);
+		float minZ(inf);
+
+		for (int i = 0; i < 8; ++i) {
+			float c[4];
+			transform(m, (i & 1) ? max[0] : min[0], (i & 2) ? max[1] : min[1], (i & 4) ? max[2] : min[2], c);
+
+			// ニアクリップ面にかかるボックスは見えているものとする
+			if (c[3] < NEAR_W) return true;
+
+			float x, y, z;
+			toScreen(c, x, y, z);
+			minX = std::min(minX, x);
+			maxX = std::max(maxX, x);
+			minY = std::min(minY, y);
+			maxY = std::max(maxY, y);
+			minZ = std::min(minZ, z);
+		}
+
+		// 画面の外やファークリップ面の奥にあれば見えない
+		if (maxX < 0.0f || maxY < 0.0f || minX >= _width || minY >= _height || minZ > 1.0f) return false;
+
+		// ボックスが覆う画素の範囲
+		int x0(std::max(0, static_cast<int>(minX))), x1(std::min(_width - 1, static_cast<int>(maxX)));
+		int y0(std::max(0, static_cast<int>(minY))), y1(std::min(_height - 1, static_cast<int>(maxY)));
+
+		// 範囲が 4x4 画素以内に収まるレベルまで上る
+		std::size_t level(0);
+		while ((x1 - x0 > 3 || y1 - y0 > 3) && level + 1 < _levels.size()) {
+			++level;
+			x0 >>= 1; x1 >>= 1;
+			y0 >>= 1; y1 >>= 1;
+		}
+
+		// 覆う画素のどれかの遮蔽物よりボックスが手前にあれば見えている
+		const std::vector<float>& depth(_levels[level]);
+		const int w(_levelWidth[level]);
+		for (int y = y0; y <= y1; ++y) {
+			for (int x = x0; x <= x1; ++x) {
+				if (minZ <= depth[y * w + x]) return true;
+			}
+		}
+
+		return false;
+	}
+
+	// デプスバッファ（レベル 0）
+	const float* getDepth() const { return _levels[0].data(); }
+
+	int getWidth() const { return _width; }
+	int getHeight() const { return _height; }
+
+	// 描いた遮蔽物の三角形の数
+	std::size_t getTriangleCount() const { return _triangles.size(); }
+};
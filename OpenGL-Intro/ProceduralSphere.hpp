@@ -0,0 +1,71 @@
+#pragma once
+#include <algorithm>
+#include <GL/glew.h>
+#include "Shape.hpp"
+
+//
+// 頂点バッファを持たない球
+//   空の頂点配列オブジェクトで描き、sphere.vert が gl_VertexID から頂点座標と法線を作る
+//   分割数は uniform 変数で渡すので、同じ図形で描くたびに分割数を変えられる
+//   gl_InstanceID ごとに中心と半径を変えて一度に複数の球を描く
+//
+class ProceduralSphere : public Shape {
+public:
+	// 一度に描けるインスタンスの数（sphere.vert の Icount と同じ）
+	static constexpr int MAX_INSTANCES = 16;
+
+private:
+	// 分割数と instance の uniform 変数の場所
+	const GLint _tessellationLocation;
+	const GLint _instanceLocation;
+
+	// 経度方向と緯度方向の分割数
+	GLint _slices, _stacks;
+
+	// インスタンスの数と、インスタンスごとの中心 (x, y, z) と半径
+	GLsizei _instanceCount;
+	GLfloat _instances[MAX_INSTANCES][4];
+
+public:
+	// program: sphere.vert を組み込んだプログラムオブジェクト
+	ProceduralSphere(ResourceManager& manager, GLuint program, GLint slices, GLint stacks)
+		: Shape(manager, manager.createEmptyMesh(), 0)
+		, _tessellationLocation(glGetUniformLocation(program, "tessellation"))
+		, _instanceLocation(glGetUniformLocation(program, "instance"))
+		, _instanceCount(1)
+	{
+		setTessellation(slices, stacks);
+
+		// 原点にある半径 1 の球を1つ描く
+		std::fill(_instances[0], _instances[0] + 4, 0.0f);
+		_instances[0][3] = 1.0f;
+	}
+
+	// 分割数を変える
+	void setTessellation(GLint slices, GLint stacks) {
+		_slices = std::max(slices, 3);
+		_stacks = std::max(stacks, 2);
+	}
+
+	// インスタンスを設定する
+	//   count: インスタンスの数, instances: インスタンスごとの中心 (x, y, z) と半径を並べた配列
+	void setInstances(GLsizei count, const GLfloat* instances) {
+		_instanceCount = std::min(count, static_cast<GLsizei>(MAX_INSTANCES));
+		std::copy(instances, instances + _instanceCount * 4, _instances[0]);
+	}
+
+	virtual void execute() const {
+		glUniform2i(_tessellationLocation, _slices, _stacks);
+		glUniform4fv(_instanceLocation, _instanceCount, _instances[0]);
+		Telemetry::add(Telemetry::UNIFORM_BYTES, sizeof(GLint) * 2 + sizeof(GLfloat) * 4 * _instanceCount);
+
+		// 1つの四角形を2つの三角形（6頂点）で描く
+		const GLsizei count(_slices * _stacks * 6);
+		glDrawArraysInstanced(GL_TRIANGLES, 0, count, _instanceCount);
+		Telemetry::draw(GL_TRIANGLES, count, _instanceCount);
+	}
+
+	GLint getSlices() const { return _slices; }
+	GLint getStacks() const { return _stacks; }
+	GLsizei getInstanceCount() const { return _instanceCount; }
+};
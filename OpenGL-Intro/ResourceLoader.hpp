@@ -0,0 +1,237 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include "LockFreeQueue.hpp"
+#include "Object.hpp"
+#include "ResourceManager.hpp"
+
+//
+// リソースの非同期読み込み
+//   描画スレッドと共有する GL コンテキストを持つスレッドで、
+//   メッシュの頂点データの生成とバッファへの転送、シェーダのリンクを行う
+//
+class ResourceLoader {
+public:
+	// メッシュの頂点データを生成する関数（読み込みスレッドで実行される）
+	using MeshDecoder = std::function<bool(std::vector<Object::Vertex>& vertex, std::vector<GLuint>& index)>;
+
+	// プログラムオブジェクトを作成する関数（読み込みスレッドで実行される）
+	using ProgramBuilder = std::function<GLuint()>;
+
+	// 読み込みが終わったときに描画スレッドで呼び出す関数
+	using MeshCallback = std::function<void(MeshHandle mesh, GLsizei vertexCount, GLsizei indexCount)>;
+	using ProgramCallback = std::function<void(ProgramHandle program)>;
+
+private:
+	// 読み込み要求
+	struct Request {
+		GLint size;
+		MeshDecoder decode;
+		ProgramBuilder build;
+		MeshCallback meshDone;
+		ProgramCallback programDone;
+	};
+
+	// 読み込み結果
+	struct Result {
+		GLint size;
+		GLuint vbo, ibo;
+		GLsizei vertexCount, indexCount;
+		GLuint program;
+		GLsync fence;
+		MeshCallback meshDone;
+		ProgramCallback programDone;
+	};
+
+	// 読み込みスレッドのコンテキストを持つ見えないウィンドウ
+	GLFWwindow* const _context;
+
+	// 描画スレッド → 読み込みスレッド
+	LockFreeQueue<Request> _requests;
+
+	// 読み込みスレッド → 描画スレッド
+	LockFreeQueue<Result> _results;
+
+	// 読み込みスレッドを起こすための同期
+	std::mutex _mutex;
+	std::condition_variable _wakeup;
+
+	// 読み込みスレッドを続けるかどうか
+	std::atomic<bool> _running;
+
+	// 読み込みスレッド
+	std::thread _thread;
+
+	// UnCopiable
+	ResourceLoader(const ResourceLoader& o) = delete;
+	ResourceLoader& operator=(const ResourceLoader& rhs) = delete;
+
+	// 読み込みスレッドの処理
+	void run() {
+		glfwMakeContextCurrent(_context);
+
+		while (_running.load()) {
+			Request request;
+			if (!_requests.pop(request)) {
+				// 要求が来るまで眠る
+				std::unique_lock<std::mutex> lock(_mutex);
+				_wakeup.wait(lock, [this] { return !_running.load() || !_requests.empty(); });
+				continue;
+			}
+
+			Result result = { request.size, 0, 0, 0, 0, 0, nullptr, std::move(request.meshDone), std::move(request.programDone) };
+
+			if (request.decode) {
+				// 頂点データを生成してバッファオブジェクトに転送する
+				std::vector<Object::Vertex> vertex;
+				std::vector<GLuint> index;
+				if (request.decode(vertex, index)) {
+					result.vertexCount = static_cast<GLsizei>(vertex.size());
+					result.indexCount = static_cast<GLsizei>(index.size());
+
+					glGenBuffers(1, &result.vbo);
+					glBindBuffer(GL_ARRAY_BUFFER, result.vbo);
+					glBufferData(GL_ARRAY_BUFFER, vertex.size() * sizeof(Object::Vertex), vertex.data(), GL_STATIC_DRAW);
+
+					glGenBuffers(1, &result.ibo);
+					glBindBuffer(GL_ARRAY_BUFFER, result.ibo);
+					glBufferData(GL_ARRAY_BUFFER, index.size() * sizeof(GLuint), index.data(), GL_STATIC_DRAW);
+					glBindBuffer(GL_ARRAY_BUFFER, 0);
+				}
+			}
+
+			if (request.build) {
+				// プログラムオブジェクトはコンテキスト間で共有できる
+				result.program = request.build();
+			}
+
+			// 転送の完了を描画スレッドに知らせるフェンス（フラッシュしないと描画スレッドから見えない）
+			result.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			glFlush();
+
+			while (!_results.push(std::move(result))) {
+				if (!_running.load()) {
+					discard(result);
+					break;
+				}
+				std::this_thread::yield();
+			}
+		}
+
+		glfwMakeContextCurrent(nullptr);
+	}
+
+	// 描画スレッドに渡さなかったか、受け取る関数がなかった結果を破棄する
+	static void discard(Result& result) {
+		if (result.fence != nullptr) glDeleteSync(result.fence);
+		if (result.vbo != 0) glDeleteBuffers(1, &result.vbo);
+		if (result.ibo != 0) glDeleteBuffers(1, &result.ibo);
+		if (result.program != 0) glDeleteProgram(result.program);
+	}
+
+	// 要求を読み込みスレッドに渡す
+	bool enqueue(Request&& request) {
+		if (!_requests.push(std::move(request))) {
+			std::cerr << "Error: Too many load requests." << std::endl;
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		_wakeup.notify_one();
+		return true;
+	}
+
+public:
+	// share: GL コンテキストを共有するウィンドウ, capacity: 同時に待てる要求の数
+	//   GLFW の制約によりメインスレッドで作成する
+	ResourceLoader(GLFWwindow* share, std::size_t capacity = 64)
+		: _context((glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE), glfwCreateWindow(1, 1, "", nullptr, share)))
+		, _requests(capacity)
+		, _results(capacity)
+		, _running(_context != nullptr)
+	{
+		glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+
+		if (_context == nullptr) {
+			std::cerr << "Can't create shared GL context." << std::endl;
+			return;
+		}
+
+		_thread = std::thread(&ResourceLoader::run, this);
+	}
+
+	virtual ~ResourceLoader() {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_running.store(false);
+		}
+		_wakeup.notify_one();
+		if (_thread.joinable()) _thread.join();
+
+		// 受け取られなかった結果を破棄する
+		Result result;
+		while (_results.pop(result)) discard(result);
+
+		if (_context != nullptr) glfwDestroyWindow(_context);
+	}
+
+	// メッシュを非同期に読み込む
+	//   decode: 頂点データを生成する関数, done: 描画スレッドで受け取る関数
+	bool loadMesh(GLint size, MeshDecoder decode, MeshCallback done) {
+		if (_context == nullptr) return false;
+		return enqueue({ size, std::move(decode), nullptr, std::move(done), nullptr });
+	}
+
+	// プログラムオブジェクトを非同期に作成する
+	bool loadProgram(ProgramBuilder build, ProgramCallback done) {
+		if (_context == nullptr) return false;
+		return enqueue({ 0, nullptr, std::move(build), nullptr, std::move(done) });
+	}
+
+	// 読み込みが終わったリソースを描画スレッドで受け取る
+	//   GPU への転送が終わっていないものは次のフレームに回すので、ここでは待たない
+	//   戻り値: 受け取ったリソースの数（コールバックがヒープを確保することがある）
+	int update(ResourceManager& manager) {
+		int count(0);
+		while (Result* const result = _results.front()) {
+			const GLenum status(glClientWaitSync(result->fence, 0, 0));
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+			glDeleteSync(result->fence);
+			result->fence = nullptr;
+
+			if (result->meshDone) {
+				const MeshHandle mesh(result->vbo != 0
+					? manager.adoptMesh(result->size, result->vbo, result->ibo,
+						result->vertexCount * sizeof(Object::Vertex) + result->indexCount * sizeof(GLuint))
+					: MeshHandle());
+
+				// 管理下に置けなかったバッファオブジェクトは捨てる
+				if (mesh.isNull()) {
+					if (result->vbo != 0) glDeleteBuffers(1, &result->vbo);
+					if (result->ibo != 0) glDeleteBuffers(1, &result->ibo);
+				}
+				result->meshDone(mesh, result->vertexCount, result->indexCount);
+				result->vbo = result->ibo = 0;
+			}
+
+			if (result->programDone) {
+				result->programDone(manager.addProgram(result->program));
+				result->program = 0;
+			}
+
+			// 受け取る関数がなかったリソースは誰も持たないので捨てる
+			discard(*result);
+			_results.discard();
+			++count;
+		}
+		return count;
+	}
+};
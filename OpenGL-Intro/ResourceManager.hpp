@@ -0,0 +1,367 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <GL/glew.h>
+#include "Allocator.hpp"
+#include "Object.hpp"
+#include "Telemetry.hpp"
+
+//
+// 世代付きハンドル
+//   下位16ビットがスロット番号、上位16ビットが世代（世代 0 は無効なハンドル）
+//
+template <typename T>
+class Handle {
+private:
+	std::uint32_t _value;
+
+public:
+	constexpr Handle()
+		: _value(0)
+	{
+	}
+
+	constexpr Handle(std::uint32_t index, std::uint32_t generation)
+		: _value((generation << 16) | (index & 0xffff))
+	{
+	}
+
+	constexpr std::uint32_t index() const { return _value & 0xffff; }
+	constexpr std::uint32_t generation() const { return _value >> 16; }
+	constexpr std::uint32_t value() const { return _value; }
+
+	constexpr bool isNull() const { return _value == 0; }
+
+	constexpr bool operator==(const Handle& h) const { return _value == h._value; }
+	constexpr bool operator!=(const Handle& h) const { return _value != h._value; }
+};
+
+//
+// バッファオブジェクト
+//
+struct Buffer {
+	// バッファオブジェクト名
+	GLuint name;
+
+	// バッファのサイズ
+	const GLsizeiptr size;
+
+	Buffer(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+		: size(size)
+	{
+		glGenBuffers(1, &name);
+		glBindBuffer(target, name);
+		glBufferData(target, size, data, usage);
+	}
+
+	~Buffer() {
+		glDeleteBuffers(1, &name);
+	}
+
+	Buffer(const Buffer& o) = delete;
+	Buffer& operator=(const Buffer& rhs) = delete;
+};
+
+//
+// シェーダのプログラムオブジェクト
+//
+struct Program {
+	// プログラムオブジェクト名
+	const GLuint name;
+
+	Program(GLuint name)
+		: name(name)
+	{
+	}
+
+	~Program() {
+		glDeleteProgram(name);
+	}
+
+	Program(const Program& o) = delete;
+	Program& operator=(const Program& rhs) = delete;
+};
+
+using MeshHandle = Handle<Object>;
+using BufferHandle = Handle<Buffer>;
+using ProgramHandle = Handle<Program>;
+
+//
+// 世代付きハンドルで参照するスロットの表
+//   オブジェクトは Pool の連続した領域に置き、世代は別の配列で管理する
+//
+template <typename T>
+class SlotTable {
+private:
+	// オブジェクトの本体
+	Pool<T> _pool;
+
+	// スロットごとの世代
+	std::unique_ptr<std::uint16_t[]> _generation;
+
+	// スロットごとの GPU メモリの使用量
+	std::unique_ptr<std::size_t[]> _bytes;
+
+public:
+	SlotTable(std::uint32_t capacity)
+		: _pool(capacity < 0xffff ? capacity : 0xffff)
+		, _generation(new std::uint16_t[_pool.getCapacity()])
+		, _bytes(new std::size_t[_pool.getCapacity()]())
+	{
+		for (std::uint32_t i = 0; i < _pool.getCapacity(); ++i) _generation[i] = 1;
+	}
+
+	// オブジェクトを作成してハンドルを返す
+	//   bytes: このオブジェクトが使う GPU メモリの量
+	template <typename... Args>
+	Handle<T> create(std::size_t bytes, Args&&... args) {
+		const std::uint32_t index(_pool.create(std::forward<Args>(args)...));
+		if (index >= _pool.getCapacity()) return Handle<T>();
+
+		_bytes[index] = bytes;
+		return Handle<T>(index, _generation[index]);
+	}
+
+	// ハンドルの指すオブジェクトを取り出す
+	//   破棄済みのハンドルなら nullptr を返す
+	T* get(Handle<T> h) {
+		const std::uint32_t index(h.index());
+		if (!_pool.isUsed(index) || _generation[index] != h.generation()) return nullptr;
+		return _pool.get(index);
+	}
+
+	const T* get(Handle<T> h) const {
+		const std::uint32_t index(h.index());
+		if (!_pool.isUsed(index) || _generation[index] != h.generation()) return nullptr;
+		return _pool.get(index);
+	}
+
+	// ハンドルを無効にする（スロットは destroy() するまで再利用しない）
+	bool retire(Handle<T> h) {
+		if (get(h) == nullptr) return false;
+
+		std::uint16_t& generation(_generation[h.index()]);
+		if (++generation == 0) generation = 1;
+		return true;
+	}
+
+	// スロットのオブジェクトを破棄する
+	void destroy(std::uint32_t index) {
+		_pool.destroy(index);
+		_bytes[index] = 0;
+	}
+
+	std::size_t getBytes(std::uint32_t index) const { return _bytes[index]; }
+	std::uint32_t getCount() const { return _pool.getCount(); }
+};
+
+//
+// GL リソースの管理
+//   メッシュ・バッファ・プログラムを世代付きハンドルで参照し、
+//   解放されたリソースは GPU が使い終わってから破棄する
+//
+class ResourceManager {
+public:
+	// リソースの種類
+	enum ResourceType {
+		MESH,
+		BUFFER,
+		PROGRAM,
+		RESOURCE_TYPE_COUNT
+	};
+
+	// リソースの使用量
+	struct Usage {
+		// 生きているリソースの数
+		std::uint32_t count;
+
+		// 生きているリソースの GPU メモリの量
+		std::size_t bytes;
+
+		// 破棄待ちのリソースの数
+		std::uint32_t pendingCount;
+
+		// 破棄待ちのリソースの GPU メモリの量
+		std::size_t pendingBytes;
+	};
+
+private:
+	// 破棄待ちのリソース
+	struct Retired {
+		ResourceType type;
+		std::uint32_t index;
+	};
+
+	// 同じフェンスを待つ破棄待ちのリソース
+	struct RetiredBatch {
+		GLsync fence;
+		std::vector<Retired> items;
+	};
+
+	SlotTable<Object> _meshes;
+	SlotTable<Buffer> _buffers;
+	SlotTable<Program> _programs;
+
+	// 前回の collect() 以降に解放されたリソース
+	std::vector<Retired> _released;
+
+	// GPU が使い終わるのを待っているリソース
+	std::vector<RetiredBatch> _retiring;
+
+	// 種類ごとの使用量
+	Usage _usage[RESOURCE_TYPE_COUNT];
+
+	// UnCopiable
+	ResourceManager(const ResourceManager& o) = delete;
+	ResourceManager& operator=(const ResourceManager& rhs) = delete;
+
+	// 解放されたリソースを使用量の集計で破棄待ちに移す
+	template <typename T>
+	bool release(SlotTable<T>& table, ResourceType type, Handle<T> h) {
+		if (!table.retire(h)) return false;
+
+		const std::size_t bytes(table.getBytes(h.index()));
+		_usage[type].count -= 1;
+		_usage[type].bytes -= bytes;
+		_usage[type].pendingCount += 1;
+		_usage[type].pendingBytes += bytes;
+
+		_released.push_back({ type, h.index() });
+		return true;
+	}
+
+	// 破棄待ちのリソースを実際に破棄する
+	void destroy(const Retired& r) {
+		std::size_t bytes(0);
+		switch (r.type) {
+		case MESH:
+			bytes = _meshes.getBytes(r.index);
+			_meshes.destroy(r.index);
+			break;
+		case BUFFER:
+			bytes = _buffers.getBytes(r.index);
+			_buffers.destroy(r.index);
+			break;
+		case PROGRAM:
+			bytes = _programs.getBytes(r.index);
+			_programs.destroy(r.index);
+			break;
+		default:
+			return;
+		}
+
+		_usage[r.type].pendingCount -= 1;
+		_usage[r.type].pendingBytes -= bytes;
+	}
+
+	// 作成したリソースを使用量に加える
+	template <typename T>
+	Handle<T> track(Handle<T> h, ResourceType type, std::size_t bytes) {
+		if (h.isNull()) {
+			std::cerr << "Error: Too many resources." << std::endl;
+			return h;
+		}
+
+		_usage[type].count += 1;
+		_usage[type].bytes += bytes;
+		Telemetry::add(Telemetry::BUFFER_BYTES, bytes);
+		return h;
+	}
+
+public:
+	ResourceManager(std::uint32_t meshCapacity = 1024, std::uint32_t bufferCapacity = 1024, std::uint32_t programCapacity = 64)
+		: _meshes(meshCapacity)
+		, _buffers(bufferCapacity)
+		, _programs(programCapacity)
+		, _usage()
+	{
+		_released.reserve(64);
+	}
+
+	virtual ~ResourceManager() {
+		// 終了時には GPU を待たずにすべて破棄する（残りは各 SlotTable のデストラクタで破棄される）
+		for (const RetiredBatch& batch : _retiring) glDeleteSync(batch.fence);
+	}
+
+	// メッシュ（頂点配列オブジェクト）を作成する
+	MeshHandle createMesh(GLint size, GLsizei vertexCount, const Object::Vertex* vertex,
+		GLsizei indexCount = 0, const GLuint* index = nullptr)
+	{
+		const std::size_t bytes(vertexCount * sizeof(Object::Vertex) + indexCount * sizeof(GLuint));
+		return track(_meshes.create(bytes, size, vertexCount, vertex, indexCount, index), MESH, bytes);
+	}
+
+	// 別のコンテキストで作成済みの頂点バッファから頂点配列オブジェクトを作成する
+	//   bytes: 頂点バッファとインデックスバッファのサイズの合計
+	MeshHandle adoptMesh(GLint size, GLuint vbo, GLuint ibo, std::size_t bytes) {
+		return track(_meshes.create(bytes, size, vbo, ibo), MESH, bytes);
+	}
+
+	// 頂点バッファを持たない空のメッシュを作成する
+	MeshHandle createEmptyMesh() {
+		return track(_meshes.create(0), MESH, 0);
+	}
+
+	// バッファオブジェクトを作成する
+	BufferHandle createBuffer(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+		const std::size_t bytes(static_cast<std::size_t>(size));
+		return track(_buffers.create(bytes, target, size, data, usage), BUFFER, bytes);
+	}
+
+	// 作成済みのプログラムオブジェクトを管理下に置く
+	ProgramHandle addProgram(GLuint program) {
+		if (program == 0) return ProgramHandle();
+		return track(_programs.create(0, program), PROGRAM, 0);
+	}
+
+	const Object* getMesh(MeshHandle h) const { return _meshes.get(h); }
+	const Buffer* getBuffer(BufferHandle h) const { return _buffers.get(h); }
+
+	// プログラムオブジェクト名を取り出す（破棄済みなら 0）
+	GLuint getProgram(ProgramHandle h) const {
+		const Program* const p(_programs.get(h));
+		return p != nullptr ? p->name : 0;
+	}
+
+	// リソースを解放する（無効なハンドルなら何もしない）
+	bool release(MeshHandle h) { return release(_meshes, MESH, h); }
+	bool release(BufferHandle h) { return release(_buffers, BUFFER, h); }
+	bool release(ProgramHandle h) { return release(_programs, PROGRAM, h); }
+
+	// GPU が使い終わったリソースを破棄する
+	//   フレームの最後に毎回呼び出す
+	void collect() {
+		// フェンスを通過したものから順に破棄する
+		std::size_t done(0);
+		while (done < _retiring.size()) {
+			const GLenum status(glClientWaitSync(_retiring[done].fence, 0, 0));
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+
+			glDeleteSync(_retiring[done].fence);
+			for (const Retired& r : _retiring[done].items) destroy(r);
+			++done;
+		}
+		_retiring.erase(_retiring.begin(), _retiring.begin() + done);
+
+		// このフレームで解放されたリソースはここまでの描画命令の完了を待つ
+		if (!_released.empty()) {
+			_retiring.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), std::move(_released) });
+			_released.clear();
+		}
+	}
+
+	const Usage& getUsage(ResourceType type) const { return _usage[type]; }
+
+	// 種類ごとの使用量を表示する
+	void printUsage(std::ostream& out) const {
+		static const char* const names[] = { "mesh", "buffer", "program" };
+		for (int i = 0; i < RESOURCE_TYPE_COUNT; ++i) {
+			out << names[i] << ": " << _usage[i].count << " (" << _usage[i].bytes << " bytes), pending "
+				<< _usage[i].pendingCount << " (" << _usage[i].pendingBytes << " bytes)" << std::endl;
+		}
+	}
+};
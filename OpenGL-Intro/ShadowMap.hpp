@@ -0,0 +1,239 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+#include <GL/glew.h>
+#include "Matrix.hpp"
+#include "Telemetry.hpp"
+
+//
+// 光源ごとのシャドウマップ
+//   デプスマップはすべて1つの2次元テクスチャ配列に置く
+//     レイヤ 0 〜 lights - 1       : 描画に使うデプスマップ（静的 + 動的な影）
+//     レイヤ lights 〜 2 lights - 1 : 静的な物体だけを描いたデプスマップ（キャッシュ）
+//   静的な物体は光源か静的な物体が変わったときだけ描き直し、
+//   毎フレームはキャッシュを複製して動いた物体だけを重ねて描く
+//
+class ShadowMap {
+private:
+	// 光源
+	struct Light {
+		// 光源の位置と向ける先
+		GLfloat position[3], target[3];
+
+		// 光源から見たビュー変換行列と投影変換行列の積
+		Matrix matrix;
+
+		// キャッシュを描き直す必要があるか
+		bool dirty;
+
+		// 描画用のレイヤがキャッシュと同じ内容か（動的な物体を描いていない）
+		bool clean;
+	};
+
+	// デプスマップのテクスチャ配列
+	GLuint _texture;
+
+	// キャッシュを読み出すフレームバッファオブジェクトと、デプスマップを描くフレームバッファオブジェクト
+	GLuint _readFbo, _drawFbo;
+
+	// デプスマップの大きさ
+	const GLsizei _size;
+
+	// 影を落とす物体を描くプログラムオブジェクトと、その変換行列の uniform 変数の場所
+	const GLuint _program;
+	const GLint _matrixLocation;
+
+	// 光源
+	std::vector<Light> _lights;
+
+	// キャッシュを描き直した回数
+	unsigned long long _staticUpdates;
+
+	// UnCopiable
+	ShadowMap(const ShadowMap& o) = delete;
+	ShadowMap& operator=(const ShadowMap& rhs) = delete;
+
+	// デプスマップのレイヤに描き始める
+	void attach(GLint layer) {
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _drawFbo);
+		glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, _texture, 0, layer);
+		Telemetry::add(Telemetry::SHADOW_PASSES);
+	}
+
+	// 回転と平行移動だけの変換行列の逆行列
+	static Matrix invertRigid(const Matrix& m) {
+		const GLfloat* const a(m.data());
+		GLfloat t[16];
+		for (int i = 0; i < 3; ++i) {
+			for (int j = 0; j < 3; ++j) t[j * 4 + i] = a[i * 4 + j];
+			t[i * 4 + 3] = 0.0f;
+			t[12 + i] = -(a[i * 4] * a[12] + a[i * 4 + 1] * a[13] + a[i * 4 + 2] * a[14]);
+		}
+		t[15] = 1.0f;
+		return Matrix(t);
+	}
+
+public:
+	// program: shadow.vert を組み込んだプログラムオブジェクト, lights: 光源の数, size: デプスマップの大きさ
+	ShadowMap(GLuint program, int lights, GLsizei size = 1024)
+		: _size(size)
+		, _program(program)
+		, _matrixLocation(glGetUniformLocation(program, "lightMatrix"))
+		, _lights(lights)
+		, _staticUpdates(0)
+	{
+		glGenTextures(1, &_texture);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, _texture);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, size, size, lights * 2, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+		Telemetry::add(Telemetry::TEXTURE_BYTES, static_cast<std::uint64_t>(size) * size * lights * 2 * 4);
+
+		// 比較モードにして sampler2DArrayShadow で 2x2 の PCF をかける
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+		// デプスマップの外は影にしない
+		static constexpr GLfloat border[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+		glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+		// デプスだけのフレームバッファオブジェクト
+		glGenFramebuffers(1, &_readFbo);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, _readFbo);
+		glReadBuffer(GL_NONE);
+		glGenFramebuffers(1, &_drawFbo);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _drawFbo);
+		glDrawBuffer(GL_NONE);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		for (Light& light : _lights) {
+			std::fill(light.position, light.position + 3, 0.0f);
+			std::fill(light.target, light.target + 3, 0.0f);
+			light.matrix.loadIdentity();
+			light.dirty = true;
+			light.clean = false;
+		}
+	}
+
+	virtual ~ShadowMap() {
+		glDeleteFramebuffers(1, &_drawFbo);
+		glDeleteFramebuffers(1, &_readFbo);
+		glDeleteTextures(1, &_texture);
+	}
+
+	// 光源を設定する（位置か向きが変わればキャッシュを描き直す）
+	//   position: 光源の位置, target: 光源を向ける先, fovy: 画角, zNear, zFar: 影を作る範囲
+	//   点光源は target に向けた透視投影の1面で近似する
+	void setLight(int index, const GLfloat* position, const GLfloat* target,
+		GLfloat fovy = 1.6f, GLfloat zNear = 1.0f, GLfloat zFar = 20.0f)
+	{
+		Light& light(_lights[index]);
+		if (!light.dirty
+			&& std::equal(position, position + 3, light.position)
+			&& std::equal(target, target + 3, light.target)) return;
+
+		std::copy(position, position + 3, light.position);
+		std::copy(target, target + 3, light.target);
+
+		// 真上か真下を向くときは上方向を x 軸にする
+		const GLfloat dx(target[0] - position[0]), dy(target[1] - position[1]), dz(target[2] - position[2]);
+		const bool vertical(dx * dx + dz * dz < 1.0e-6f * (dy * dy));
+		light.matrix = Matrix::perspective(fovy, 1.0f, zNear, zFar) * Matrix::lookat(
+			position[0], position[1], position[2],
+			target[0], target[1], target[2],
+			vertical ? 1.0f : 0.0f, vertical ? 0.0f : 1.0f, 0.0f);
+		light.dirty = true;
+	}
+
+	// 静的な物体が変わったのですべてのキャッシュを描き直す
+	void invalidate() {
+		for (Light& light : _lights) light.dirty = true;
+	}
+
+	// デプスマップを描く
+	//   drawStatic(light): 光源 light の静的な物体を描く（キャッシュを描き直すときだけ呼ぶ）
+	//   drawDynamic(light): 光源 light の動的な物体を描く
+	//   dynamic: このフレームに動的な物体があるか（なければキャッシュの複製も省く）
+	//   それぞれの物体は cast() で変換行列を設定してから描く
+	//   終わると既定のフレームバッファを結合するので、ビューポートは呼び出し側で戻す
+	template <typename StaticCasters, typename DynamicCasters>
+	void render(StaticCasters drawStatic, DynamicCasters drawDynamic, bool dynamic = true) {
+		const int count(static_cast<int>(_lights.size()));
+
+		glUseProgram(_program);
+		Telemetry::add(Telemetry::PROGRAM_BINDS);
+		glViewport(0, 0, _size, _size);
+
+		// 自己遮蔽による縞を避けるためにデプスをずらす
+		glEnable(GL_POLYGON_OFFSET_FILL);
+		glPolygonOffset(2.0f, 4.0f);
+
+		for (int i = 0; i < count; ++i) {
+			Light& light(_lights[i]);
+
+			// 光源か静的な物体が変わっていればキャッシュを描き直す
+			if (light.dirty) {
+				attach(count + i);
+				glClear(GL_DEPTH_BUFFER_BIT);
+				drawStatic(i);
+				light.dirty = false;
+				light.clean = false;
+				++_staticUpdates;
+			}
+
+			// 動的な物体がなく、前のフレームも複製したままなら何もしない
+			if (!dynamic && light.clean) continue;
+
+			// キャッシュを描画用のレイヤに複製する
+			attach(i);
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, _readFbo);
+			glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, _texture, 0, count + i);
+			glBlitFramebuffer(0, 0, _size, _size, 0, 0, _size, _size, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+			// 動いた物体だけを重ねる
+			if (dynamic) drawDynamic(i);
+			light.clean = !dynamic;
+		}
+
+		glDisable(GL_POLYGON_OFFSET_FILL);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	// 次に描く物体の変換行列を設定する
+	//   matrix: 光源の変換行列に物体のモデル変換行列を乗じたもの
+	void cast(const GLfloat* matrix) const {
+		glUniformMatrix4fv(_matrixLocation, 1, GL_FALSE, matrix);
+		Telemetry::add(Telemetry::UNIFORM_BYTES, sizeof(GLfloat) * 16);
+	}
+
+	void cast(const Matrix& matrix) const { cast(matrix.data()); }
+
+	// デプスマップのテクスチャ配列をテクスチャユニットに結合する
+	void bind(GLuint unit) const {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, _texture);
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	// 視点座標系からデプスマップのテクスチャ座標への変換行列を求める
+	//   view: 描画に使うビュー変換行列（回転と平行移動だけのもの）
+	Matrix getShadowMatrix(int index, const Matrix& view) const {
+		// [-1, 1] を [0, 1] に移す
+		static constexpr GLfloat bias[] = {
+			0.5f, 0.0f, 0.0f, 0.0f,
+			0.0f, 0.5f, 0.0f, 0.0f,
+			0.0f, 0.0f, 0.5f, 0.0f,
+			0.5f, 0.5f, 0.5f, 1.0f
+		};
+		return Matrix(bias) * _lights[index].matrix * invertRigid(view);
+	}
+
+	// 光源から見たビュー変換行列と投影変換行列の積
+	const Matrix& getLightMatrix(int index) const { return _lights[index].matrix; }
+
+	int getLightCount() const { return static_cast<int>(_lights.size()); }
+	unsigned long long getStaticUpdates() const { return _staticUpdates; }
+};
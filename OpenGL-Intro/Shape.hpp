@@ -1,23 +1,47 @@
 #pragma once
 #include "Object.hpp"
-#include <memory>
+#include "ResourceManager.hpp"
 
 class Shape {
 private:
-	std::shared_ptr<const Object> _object;
+	// 頂点配列オブジェクトを管理するリソースマネージャ
+	ResourceManager& _manager;
+
+	// 頂点配列オブジェクトのハンドル
+	const MeshHandle _object;
+
+	// UnCopiable
+	Shape(const Shape& o) = delete;
+	Shape& operator=(const Shape& rhs) = delete;
 
 protected:
 	const GLsizei _vertexCount;
 public:
-	Shape(GLint size, GLsizei vertexCount, const Object::Vertex* vertex, GLsizei indexCount = 0, const GLuint* index = nullptr)
-		: _object(new Object(size, vertexCount, vertex, indexCount, index))
+	Shape(ResourceManager& manager, GLint size, GLsizei vertexCount, const Object::Vertex* vertex, GLsizei indexCount = 0, const GLuint* index = nullptr)
+		: _manager(manager)
+		, _object(manager.createMesh(size, vertexCount, vertex, indexCount, index))
+		, _vertexCount(vertexCount)
+	{
+	}
+
+	// 作成済みの頂点配列オブジェクトの所有権を引き受ける
+	Shape(ResourceManager& manager, MeshHandle object, GLsizei vertexCount)
+		: _manager(manager)
+		, _object(object)
 		, _vertexCount(vertexCount)
 	{
 	}
 
+	virtual ~Shape() {
+		// GPUが使い終わってから頂点配列オブジェクトを破棄する
+		_manager.release(_object);
+	}
+
 	void draw() const {
 		// 頂点配列オブジェクトを結合する
-		_object->bind();
+		const Object* const object(_manager.getMesh(_object));
+		if (object == nullptr) return;
+		object->bind();
 
 		execute();
 	}
@@ -25,5 +49,6 @@ public:
 	virtual void execute() const {
 		// 折れ線として描画
 		glDrawArrays(GL_LINE_LOOP, 0, _vertexCount);
+		Telemetry::draw(GL_LINE_LOOP, _vertexCount);
 	}
 };
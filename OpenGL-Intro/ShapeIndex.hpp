@@ -6,14 +6,21 @@ protected:
 	const GLsizei _indexCount;
 
 public:
-	ShapeIndex(GLint size, GLsizei vertexCount, const Object::Vertex* vertex,
+	ShapeIndex(ResourceManager& manager, GLint size, GLsizei vertexCount, const Object::Vertex* vertex,
 		GLsizei indexCount, const GLuint* index) 
-		: Shape(size, vertexCount, vertex, indexCount, index)
+		: Shape(manager, size, vertexCount, vertex, indexCount, index)
+		, _indexCount(indexCount)
+	{
+	}
+
+	ShapeIndex(ResourceManager& manager, MeshHandle object, GLsizei vertexCount, GLsizei indexCount)
+		: Shape(manager, object, vertexCount)
 		, _indexCount(indexCount)
 	{
 	}
 
 	virtual void execute() const {
 		glDrawElements(GL_LINES, _indexCount, GL_UNSIGNED_INT, 0);
+		Telemetry::draw(GL_LINES, _indexCount);
 	}
 };
@@ -5,13 +5,19 @@ class SolidShapeIndex : public ShapeIndex {
 private:
 
 public:
-	SolidShapeIndex(GLsizei size, GLsizei vertexCount, const Object::Vertex* vertex, GLsizei indexCount, const GLuint* index) 
-		: ShapeIndex(size, vertexCount, vertex, indexCount, index)
+	SolidShapeIndex(ResourceManager& manager, GLsizei size, GLsizei vertexCount, const Object::Vertex* vertex, GLsizei indexCount, const GLuint* index) 
+		: ShapeIndex(manager, size, vertexCount, vertex, indexCount, index)
 	{
 
 	}
 
+	SolidShapeIndex(ResourceManager& manager, MeshHandle object, GLsizei vertexCount, GLsizei indexCount)
+		: ShapeIndex(manager, object, vertexCount, indexCount)
+	{
+	}
+
 	virtual void execute() const {
 		glDrawElements(GL_TRIANGLES, _indexCount, GL_UNSIGNED_INT, 0);
+		Telemetry::draw(GL_TRIANGLES, _indexCount);
 	}
 };
@@ -0,0 +1,286 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <GL/glew.h>
+
+//
+// 描画の計測カウンタ
+//   描画スレッドの処理の中で数え、RenderStatistics::endFrame() でフレームごとに締める
+//   加算だけなので、製品版でも有効にしたままにできる
+//
+namespace Telemetry {
+	// フレームごとに数える量
+	enum Counter {
+		DRAW_CALLS,		// 描画命令の数
+		TRIANGLES,		// 送った三角形の数
+		VERTICES,		// 送った頂点の数（インデックスの数）
+		UNIFORM_BYTES,	// uniform 変数・ユニフォームバッファに送ったバイト数
+		BUFFER_BYTES,	// 確保したバッファオブジェクトのバイト数
+		TEXTURE_BYTES,	// 確保したテクスチャのバイト数
+		PROGRAM_BINDS,	// プログラムオブジェクトの切り替え
+		VAO_BINDS,		// 頂点配列オブジェクトの結合
+		UBO_BINDS,		// ユニフォームバッファオブジェクトの結合
+		SHADOW_PASSES,	// シャドウマップのレイヤへの描画
+		GL_ERRORS,		// GL のエラー
+		COUNTER_COUNT
+	};
+
+	// フレームごとに測る量
+	enum Gauge {
+		FRAME_TIME,		// フレームの間隔（秒）
+		STALL_TIME,		// GPU を待った時間（秒）
+		CAPTURE_TIME,	// 画面のキャプチャにかかった時間（秒）
+		SCENE_GPU_TIME,	// シーンの描画に GPU がかかった時間（秒）
+		RESOLUTION_SCALE,	// シーンを描く解像度の倍率
+		GAUGE_COUNT
+	};
+
+	// 1フレームの計測値
+	struct Frame {
+		std::uint64_t counter[COUNTER_COUNT];
+		double gauge[GAUGE_COUNT];
+	};
+
+	// 計測中のフレーム（描画スレッドだけが書き込む）
+	inline Frame current{};
+
+	// デバッグ出力のコールバックで数えたエラー（ドライバのスレッドから呼ばれることがある）
+	inline std::atomic<std::uint64_t> debugErrors(0);
+
+	inline void add(Counter counter, std::uint64_t n = 1) { current.counter[counter] += n; }
+	inline void set(Gauge gauge, double value) { current.gauge[gauge] = value; }
+
+	// 描画命令を数える
+	//   mode: 基本図形, count: 頂点（インデックス）の数, instances: インスタンス数
+	inline void draw(GLenum mode, GLsizei count, GLsizei instances = 1) {
+		std::uint64_t triangles(0);
+		switch (mode) {
+		case GL_TRIANGLES:
+			triangles = count / 3;
+			break;
+		case GL_TRIANGLE_STRIP:
+		case GL_TRIANGLE_FAN:
+			triangles = count > 2 ? count - 2 : 0;
+			break;
+		default:
+			break;
+		}
+
+		current.counter[DRAW_CALLS] += 1;
+		current.counter[TRIANGLES] += triangles * instances;
+		current.counter[VERTICES] += static_cast<std::uint64_t>(count) * instances;
+	}
+
+	// GL_KHR_debug のメッセージを受け取る
+	//   source, length, userParam は使わない
+	inline void GLAPIENTRY debugMessage(GLenum /* source */, GLenum type, GLuint id, GLenum severity,
+		GLsizei /* length */, const GLchar* message, const void* /* userParam */)
+	{
+		if (type != GL_DEBUG_TYPE_ERROR) return;
+
+		// 毎フレーム同じエラーが出てもログが埋まらないように、最初のいくつかだけ表示する
+		static constexpr std::uint64_t printLimit(8);
+		static std::atomic<std::uint64_t> received(0);
+		debugErrors.fetch_add(1);
+
+		const std::uint64_t n(received.fetch_add(1));
+		if (n < printLimit) {
+			const char* const level(severity == GL_DEBUG_SEVERITY_HIGH ? "high"
+				: severity == GL_DEBUG_SEVERITY_MEDIUM ? "medium"
+				: severity == GL_DEBUG_SEVERITY_LOW ? "low" : "notification");
+			std::cerr << "Error: GL debug output (id " << id << ", " << level << "): " << message << std::endl;
+		}
+		else if (n == printLimit) {
+			std::cerr << "Error: Further GL debug messages are suppressed." << std::endl;
+		}
+	}
+
+	// 現在のコンテキストで GL_KHR_debug のエラー通知を受け取る
+	//   戻り値: 使えれば true（使えなければ glGetError() で調べる）
+	inline bool enableDebugOutput() {
+		if (!GLEW_KHR_debug) return false;
+
+		// 通知が描画スレッドと非同期になっても数は atomic で数えるので同期出力にはしない
+		glEnable(GL_DEBUG_OUTPUT);
+		glDebugMessageCallback(debugMessage, nullptr);
+		glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+		glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_ERROR, GL_DONT_CARE, 0, nullptr, GL_TRUE);
+		return true;
+	}
+}
+
+//
+// 描画の計測値の移動平均
+//   直近 window フレームの平均を保ち、interval 秒ごとに標準エラー出力と CSV ファイルに書き出す
+//
+class RenderStatistics {
+private:
+	// 直近のフレームの計測値のリング
+	std::vector<Telemetry::Frame> _history;
+
+	// 次に書き込むリングの位置
+	std::size_t _next;
+
+	// リングに入っているフレーム数
+	std::size_t _count;
+
+	// リング内の計測値の合計
+	Telemetry::Frame _sum;
+
+	// 直前に締めたフレームの計測値
+	Telemetry::Frame _last;
+
+	// 締めたフレームの総数
+	std::uint64_t _frameCount;
+
+	// GL_KHR_debug でエラーを数えているか
+	const bool _debugOutput;
+
+	// 書き出しの間隔（秒、0 以下なら書き出さない）
+	const double _interval;
+
+	// 前のフレームを締めた時刻と、前に書き出した時刻
+	std::chrono::steady_clock::time_point _frameStart, _dumpStart;
+
+	// 書き出す CSV ファイル
+	std::ofstream _csv;
+
+	// UnCopiable
+	RenderStatistics(const RenderStatistics& o) = delete;
+	RenderStatistics& operator=(const RenderStatistics& rhs) = delete;
+
+	// 計測値の名前
+	static const char* counterName(int counter) {
+		static const char* const names[] = {
+			"draws", "triangles", "vertices", "uniform_bytes", "buffer_bytes", "texture_bytes",
+			"program_binds", "vao_binds", "ubo_binds", "shadow_passes", "gl_errors"
+		};
+		return names[counter];
+	}
+
+	static const char* gaugeName(int gauge) {
+		static const char* const names[] = { "frame_ms", "stall_ms", "capture_ms", "gpu_ms", "scale" };
+		return names[gauge];
+	}
+
+	// 書き出すときに掛ける値（時間はミリ秒にする）
+	static double gaugeUnit(int gauge) {
+		return gauge == Telemetry::RESOLUTION_SCALE ? 1.0 : 1000.0;
+	}
+
+	// 平均を書き出す
+	void dump() {
+		char line[512];
+		int n(std::snprintf(line, sizeof line, "Stats: frame %llu", static_cast<unsigned long long>(_frameCount)));
+		for (int i = 0; i < Telemetry::GAUGE_COUNT && n < static_cast<int>(sizeof line); ++i) {
+			n += std::snprintf(line + n, sizeof line - n, ", %s %.3f", gaugeName(i), getAverage(static_cast<Telemetry::Gauge>(i)) * gaugeUnit(i));
+		}
+		for (int i = 0; i < Telemetry::COUNTER_COUNT && n < static_cast<int>(sizeof line); ++i) {
+			n += std::snprintf(line + n, sizeof line - n, ", %s %.1f", counterName(i), getAverage(static_cast<Telemetry::Counter>(i)));
+		}
+		std::cerr << line << std::endl;
+
+		if (_csv.is_open()) {
+			_csv << _frameCount;
+			for (int i = 0; i < Telemetry::GAUGE_COUNT; ++i) _csv << ',' << getAverage(static_cast<Telemetry::Gauge>(i)) * gaugeUnit(i);
+			for (int i = 0; i < Telemetry::COUNTER_COUNT; ++i) _csv << ',' << getAverage(static_cast<Telemetry::Counter>(i));
+			_csv << std::endl;
+		}
+	}
+
+public:
+	// window: 平均をとるフレーム数, interval: 書き出しの間隔（秒）, csv: 書き出す CSV ファイル名（nullptr なら書き出さない）
+	//   GL コンテキストを作った後に作成する
+	RenderStatistics(std::size_t window = 120, double interval = 5.0, const char* csv = nullptr)
+		: _history(window > 0 ? window : 1)
+		, _next(0)
+		, _count(0)
+		, _sum{}
+		, _last{}
+		, _frameCount(0)
+		, _debugOutput(Telemetry::enableDebugOutput())
+		, _interval(interval)
+		, _frameStart(std::chrono::steady_clock::now())
+		, _dumpStart(_frameStart)
+	{
+		if (csv == nullptr) return;
+
+		_csv.open(csv);
+		if (_csv.fail()) {
+			std::cerr << "Error: Can't open statistics file: " << csv << std::endl;
+			return;
+		}
+
+		_csv << "frame";
+		for (int i = 0; i < Telemetry::GAUGE_COUNT; ++i) _csv << ',' << gaugeName(i);
+		for (int i = 0; i < Telemetry::COUNTER_COUNT; ++i) _csv << ',' << counterName(i);
+		_csv << std::endl;
+	}
+
+	// フレームを締めて計測値を移動平均に加える（バッファを入れ替える前に呼ぶ）
+	void endFrame() {
+		const auto now(std::chrono::steady_clock::now());
+		Telemetry::set(Telemetry::FRAME_TIME, std::chrono::duration<double>(now - _frameStart).count());
+		_frameStart = now;
+
+		// GL のエラーを集める
+		if (_debugOutput) {
+			Telemetry::add(Telemetry::GL_ERRORS, Telemetry::debugErrors.exchange(0));
+		}
+		else {
+			while (glGetError() != GL_NO_ERROR) Telemetry::add(Telemetry::GL_ERRORS);
+		}
+
+		// リングから押し出されるフレームを合計から除いて、このフレームを加える
+		Telemetry::Frame& slot(_history[_next]);
+		for (int i = 0; i < Telemetry::COUNTER_COUNT; ++i) {
+			if (_count == _history.size()) _sum.counter[i] -= slot.counter[i];
+			_sum.counter[i] += Telemetry::current.counter[i];
+		}
+		for (int i = 0; i < Telemetry::GAUGE_COUNT; ++i) {
+			if (_count == _history.size()) _sum.gauge[i] -= slot.gauge[i];
+			_sum.gauge[i] += Telemetry::current.gauge[i];
+		}
+		slot = Telemetry::current;
+		_next = (_next + 1) % _history.size();
+		if (_count < _history.size()) ++_count;
+
+		_last = Telemetry::current;
+		++_frameCount;
+
+		// 次のフレームは 0 から数える
+		Telemetry::current = Telemetry::Frame{};
+
+		if (_interval > 0.0 && std::chrono::duration<double>(now - _dumpStart).count() >= _interval) {
+			dump();
+			_dumpStart = now;
+		}
+	}
+
+	// 直近 window フレームの平均
+	double getAverage(Telemetry::Counter counter) const {
+		return _count > 0 ? static_cast<double>(_sum.counter[counter]) / _count : 0.0;
+	}
+
+	double getAverage(Telemetry::Gauge gauge) const {
+		return _count > 0 ? _sum.gauge[gauge] / _count : 0.0;
+	}
+
+	// 直前に締めたフレームの計測値
+	const Telemetry::Frame& getLast() const { return _last; }
+
+	std::uint64_t getFrameCount() const { return _frameCount; }
+
+	// 移動平均を1行にまとめる（ウィンドウのタイトルなどに表示する）
+	void format(char* buffer, std::size_t size) const {
+		std::snprintf(buffer, size, "%.2f ms (stall %.2f ms, gpu %.2f ms), scale %.2f, %.0f draws, %.0f triangles, %.0f errors",
+			getAverage(Telemetry::FRAME_TIME) * 1000.0, getAverage(Telemetry::STALL_TIME) * 1000.0,
+			getAverage(Telemetry::SCENE_GPU_TIME) * 1000.0, getAverage(Telemetry::RESOLUTION_SCALE),
+			getAverage(Telemetry::DRAW_CALLS), getAverage(Telemetry::TRIANGLES), getAverage(Telemetry::GL_ERRORS));
+	}
+};
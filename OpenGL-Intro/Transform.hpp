@@ -0,0 +1,15 @@
+#pragma once
+#include <array>
+#include <GL/glew.h>
+
+struct Transform
+{
+  // モデルビュー変換行列
+  alignas(16) std::array<GLfloat, 16> modelView;
+
+  // 投影変換行列
+  alignas(16) std::array<GLfloat, 16> projection;
+
+  // 法線ベクトルの変換行列（std140 では mat3 の各列が vec4 に揃えられる）
+  alignas(16) std::array<GLfloat, 12> normalMatrix;
+};
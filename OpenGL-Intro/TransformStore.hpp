@@ -0,0 +1,266 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <GL/glew.h>
+#include "Matrix.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <xmmintrin.h>
+#define TRANSFORM_STORE_SSE2
+#endif
+
+//
+// 大量のインスタンスの位置・回転・拡大率を列ごとに持つ変換の表（structure of arrays）
+//   回転は四元数で持つので、毎フレームの合成に三角関数や平方根を使わない
+//   compose() は4インスタンスずつ SIMD でまとめてモデル変換行列と法線変換行列を作る
+//
+class TransformStore {
+public:
+	// 列の種類
+	enum Column {
+		POSITION_X, POSITION_Y, POSITION_Z,
+		ROTATION_X, ROTATION_Y, ROTATION_Z, ROTATION_W,
+		SCALE_X, SCALE_Y, SCALE_Z,
+		COLUMN_COUNT
+	};
+
+private:
+	// 列ごとの値
+	std::vector<GLfloat> _columns[COLUMN_COUNT];
+
+	// インスタンスの数と上限
+	std::uint32_t _count;
+	const std::uint32_t _capacity;
+
+	// UnCopiable
+	TransformStore(const TransformStore& o) = delete;
+	TransformStore& operator=(const TransformStore& rhs) = delete;
+
+#if defined(TRANSFORM_STORE_SSE2)
+	// 4インスタンス分の値
+	struct Lane4 {
+		__m128 v;
+
+		Lane4() {}
+		Lane4(__m128 v) : v(v) {}
+		Lane4(GLfloat x) : v(_mm_set1_ps(x)) {}
+
+		Lane4 operator+(const Lane4& b) const { return _mm_add_ps(v, b.v); }
+		Lane4 operator-(const Lane4& b) const { return _mm_sub_ps(v, b.v); }
+		Lane4 operator*(const Lane4& b) const { return _mm_mul_ps(v, b.v); }
+	};
+#endif
+
+	// 位置 p・回転 q・拡大率 s の変換に parent を乗じた行列 m と、その法線変換行列 n を求める
+	//   L は GLfloat（1インスタンス）か Lane4（4インスタンス）
+	template <typename L>
+	static void composeLanes(const L p[3], const L q[4], const L s[3], const GLfloat* parent, L m[16], L n[9]) {
+		const L one(1.0f), two(2.0f);
+		const L xx(q[0] * q[0]), yy(q[1] * q[1]), zz(q[2] * q[2]);
+		const L xy(q[0] * q[1]), yz(q[1] * q[2]), zx(q[2] * q[0]);
+		const L wx(q[3] * q[0]), wy(q[3] * q[1]), wz(q[3] * q[2]);
+
+		// 回転に拡大率を掛けた 3x3 の各列
+		const L r[9] = {
+			(one - two * (yy + zz)) * s[0], two * (xy + wz) * s[0], two * (zx - wy) * s[0],
+			two * (xy - wz) * s[1], (one - two * (xx + zz)) * s[1], two * (yz + wx) * s[1],
+			two * (zx + wy) * s[2], two * (yz - wx) * s[2], (one - two * (xx + yy)) * s[2]
+		};
+
+		// 親の変換行列を乗じる（平行移動の列は w = 1、それ以外は w = 0）
+		for (int i = 0; i < 4; ++i) {
+			const L p0(parent[i]), p1(parent[4 + i]), p2(parent[8 + i]), p3(parent[12 + i]);
+			for (int j = 0; j < 3; ++j) {
+				m[j * 4 + i] = p0 * r[j * 3] + p1 * r[j * 3 + 1] + p2 * r[j * 3 + 2];
+			}
+			m[12 + i] = p0 * p[0] + p1 * p[1] + p2 * p[2] + p3;
+		}
+
+		// 法線変換行列（Matrix::getNormalMatrix() と同じ余因子行列）
+		n[0] = m[ 5] * m[10] - m[ 6] * m[ 9];
+		n[1] = m[ 6] * m[ 8] - m[ 4] * m[10];
+		n[2] = m[ 4] * m[ 9] - m[ 5] * m[ 8];
+		n[3] = m[ 9] * m[ 2] - m[10] * m[ 1];
+		n[4] = m[10] * m[ 0] - m[ 8] * m[ 2];
+		n[5] = m[ 8] * m[ 1] - m[ 9] * m[ 0];
+		n[6] = m[ 1] * m[ 6] - m[ 2] * m[ 5];
+		n[7] = m[ 2] * m[ 4] - m[ 0] * m[ 6];
+		n[8] = m[ 0] * m[ 5] - m[ 1] * m[ 4];
+	}
+
+	// 1インスタンスの変換を求める
+	void composeScalar(std::uint32_t index, const GLfloat* parent, GLfloat m[16], GLfloat n[9]) const {
+		const GLfloat p[] = { _columns[POSITION_X][index], _columns[POSITION_Y][index], _columns[POSITION_Z][index] };
+		const GLfloat q[] = { _columns[ROTATION_X][index], _columns[ROTATION_Y][index], _columns[ROTATION_Z][index], _columns[ROTATION_W][index] };
+		const GLfloat s[] = { _columns[SCALE_X][index], _columns[SCALE_Y][index], _columns[SCALE_Z][index] };
+		composeLanes<GLfloat>(p, q, s, parent, m, n);
+	}
+
+	// first から count 個のインスタンスの変換を求める
+	void composeRange(const GLfloat* parent, std::uint32_t first, std::uint32_t count, GLfloat* model, GLfloat* normal) const {
+		std::uint32_t i(first);
+		const std::uint32_t end(first + count);
+
+#if defined(TRANSFORM_STORE_SSE2)
+		for (; i + 4 <= end; i += 4) {
+			const Lane4 p[] = {
+				_mm_loadu_ps(&_columns[POSITION_X][i]), _mm_loadu_ps(&_columns[POSITION_Y][i]), _mm_loadu_ps(&_columns[POSITION_Z][i])
+			};
+			const Lane4 q[] = {
+				_mm_loadu_ps(&_columns[ROTATION_X][i]), _mm_loadu_ps(&_columns[ROTATION_Y][i]),
+				_mm_loadu_ps(&_columns[ROTATION_Z][i]), _mm_loadu_ps(&_columns[ROTATION_W][i])
+			};
+			const Lane4 s[] = {
+				_mm_loadu_ps(&_columns[SCALE_X][i]), _mm_loadu_ps(&_columns[SCALE_Y][i]), _mm_loadu_ps(&_columns[SCALE_Z][i])
+			};
+
+			Lane4 m[16], n[9];
+			composeLanes<Lane4>(p, q, s, parent, m, n);
+
+			// 要素ごとに並んだ値をインスタンスごとの行列に並べ替える
+			GLfloat* const dm(model + static_cast<std::size_t>(i) * 16);
+			for (int k = 0; k < 16; k += 4) {
+				__m128 c0(m[k].v), c1(m[k + 1].v), c2(m[k + 2].v), c3(m[k + 3].v);
+				_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+				_mm_storeu_ps(dm + k, c0);
+				_mm_storeu_ps(dm + 16 + k, c1);
+				_mm_storeu_ps(dm + 32 + k, c2);
+				_mm_storeu_ps(dm + 48 + k, c3);
+			}
+
+			if (normal == nullptr) continue;
+			GLfloat* const dn(normal + static_cast<std::size_t>(i) * 12);
+			for (int k = 0; k < 3; ++k) {
+				__m128 c0(n[k * 3].v), c1(n[k * 3 + 1].v), c2(n[k * 3 + 2].v), c3(_mm_setzero_ps());
+				_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+				_mm_storeu_ps(dn + k * 4, c0);
+				_mm_storeu_ps(dn + 12 + k * 4, c1);
+				_mm_storeu_ps(dn + 24 + k * 4, c2);
+				_mm_storeu_ps(dn + 36 + k * 4, c3);
+			}
+		}
+#endif
+
+		// SIMD で扱えない端数
+		for (; i < end; ++i) {
+			GLfloat n[9];
+			composeScalar(i, parent, model + static_cast<std::size_t>(i) * 16, n);
+
+			if (normal == nullptr) continue;
+			GLfloat* const dn(normal + static_cast<std::size_t>(i) * 12);
+			for (int k = 0; k < 3; ++k) {
+				dn[k * 4] = n[k * 3];
+				dn[k * 4 + 1] = n[k * 3 + 1];
+				dn[k * 4 + 2] = n[k * 3 + 2];
+				dn[k * 4 + 3] = 0.0f;
+			}
+		}
+	}
+
+public:
+	// capacity: インスタンスの上限
+	TransformStore(std::uint32_t capacity)
+		: _count(0)
+		, _capacity(capacity)
+	{
+		for (std::vector<GLfloat>& column : _columns) column.resize(capacity);
+	}
+
+	// インスタンスを加える（位置 0・回転なし・拡大率 1）
+	//   戻り値: インスタンスの番号（上限に達していれば getCapacity()）
+	std::uint32_t create() {
+		if (_count >= _capacity) return _capacity;
+
+		const std::uint32_t index(_count++);
+		setPosition(index, 0.0f, 0.0f, 0.0f);
+		setRotation(index, 0.0f, 0.0f, 0.0f, 1.0f);
+		setScale(index, 1.0f, 1.0f, 1.0f);
+		return index;
+	}
+
+	// インスタンスを取り除く
+	//   最後のインスタンスを index に移して詰めるので、最後のインスタンスの番号が変わる
+	void destroy(std::uint32_t index) {
+		if (index >= _count) return;
+
+		--_count;
+		for (std::vector<GLfloat>& column : _columns) column[index] = column[_count];
+	}
+
+	void clear() { _count = 0; }
+
+	void setPosition(std::uint32_t index, GLfloat x, GLfloat y, GLfloat z) {
+		_columns[POSITION_X][index] = x;
+		_columns[POSITION_Y][index] = y;
+		_columns[POSITION_Z][index] = z;
+	}
+
+	// 回転を四元数 (x, y, z, w) で設定する（正規化しておくこと）
+	void setRotation(std::uint32_t index, GLfloat x, GLfloat y, GLfloat z, GLfloat w) {
+		_columns[ROTATION_X][index] = x;
+		_columns[ROTATION_Y][index] = y;
+		_columns[ROTATION_Z][index] = z;
+		_columns[ROTATION_W][index] = w;
+	}
+
+	// 回転を (x, y, z) を軸に a 回転として設定する（Matrix::rotate() と同じ向き）
+	void setAxisAngle(std::uint32_t index, GLfloat a, GLfloat x, GLfloat y, GLfloat z) {
+		const GLfloat d(std::sqrt(x * x + y * y + z * z));
+		if (d == 0.0f) {
+			setRotation(index, 0.0f, 0.0f, 0.0f, 1.0f);
+			return;
+		}
+
+		const GLfloat s(std::sin(a * 0.5f) / d);
+		setRotation(index, x * s, y * s, z * s, std::cos(a * 0.5f));
+	}
+
+	void setScale(std::uint32_t index, GLfloat x, GLfloat y, GLfloat z) {
+		_columns[SCALE_X][index] = x;
+		_columns[SCALE_Y][index] = y;
+		_columns[SCALE_Z][index] = z;
+	}
+
+	// 列の値（アニメーションで列ごとにまとめて書き換えるのに使う）
+	GLfloat* getColumn(Column column) { return _columns[column].data(); }
+	const GLfloat* getColumn(Column column) const { return _columns[column].data(); }
+
+	// first から count 個のインスタンスのモデル変換行列に parent を乗じた行列と法線変換行列を求める
+	//   model: インスタンスごとに 16 要素, normal: インスタンスごとに std140 の mat3 の 12 要素（nullptr なら求めない）
+	//   どちらもインスタンスの番号の位置に書き込む
+	void compose(const Matrix& parent, std::uint32_t first, std::uint32_t count, GLfloat* model, GLfloat* normal = nullptr) const {
+		if (first >= _count) return;
+		composeRange(parent.data(), first, std::min(count, _count - first), model, normal);
+	}
+
+	// すべてのインスタンスの変換を threads 個のスレッドで分担して求める
+	void compose(const Matrix& parent, GLfloat* model, GLfloat* normal = nullptr, int threads = 1) const {
+		if (threads <= 1 || _count < 1024) {
+			composeRange(parent.data(), 0, _count, model, normal);
+			return;
+		}
+
+		// SIMD の4インスタンス単位で分ける（切り上げて、最後のスレッドまでで _count に届くようにする）
+		const std::uint32_t chunk(((_count + threads - 1) / threads + 3) & ~3u);
+		std::vector<std::thread> workers;
+		std::uint32_t first(chunk);
+		for (int i = 1; i < threads && first < _count; ++i, first += chunk) {
+			workers.emplace_back(&TransformStore::composeRange, this, parent.data(), first, std::min(chunk, _count - first), model, normal);
+		}
+		composeRange(parent.data(), 0, std::min(chunk, _count), model, normal);
+		for (std::thread& worker : workers) worker.join();
+	}
+
+	// 1インスタンスの変換を Matrix として取り出す（既存の Matrix を使う処理との互換用）
+	Matrix getMatrix(std::uint32_t index, const Matrix& parent = Matrix::identity()) const {
+		GLfloat m[16], n[9];
+		composeScalar(index, parent.data(), m, n);
+		return Matrix(m);
+	}
+
+	std::uint32_t getCount() const { return _count; }
+	std::uint32_t getCapacity() const { return _capacity; }
+};
@@ -1,67 +1,62 @@
 #pragma once
-#include <memory>
 #include <GL/glew.h>
+#include "ResourceManager.hpp"
+#include "Telemetry.hpp"
 
 template <typename T>
 class Uniform
 {
-  struct UniformBuffer
-  {
-    // ユニフォームバッファオブジェクト名
-    GLuint ubo;
-
-    // コンストラクタ
-    //   data: uniform ブロックに格納するデータ
-    UniformBuffer(const T *data)
-    {
-      // ユニフォームバッファオブジェクトを作成する
-      glGenBuffers(1, &ubo);
-      glBindBuffer(GL_UNIFORM_BUFFER, ubo);
-      glBufferData(GL_UNIFORM_BUFFER,
-        sizeof (T), data, GL_STATIC_DRAW);
-    }
+  // バッファオブジェクトを管理するリソースマネージャ
+  ResourceManager &manager;
 
-    // デストラクタ
-    ~UniformBuffer()
-    {
-      // ユニフォームバッファオブジェクトを削除する
-      glDeleteBuffers(1, &ubo);
-    }
-  };
+  // バッファオブジェクトのハンドル
+  const BufferHandle buffer;
 
-  // バッファオブジェクト
-  const std::shared_ptr<const UniformBuffer> buffer;
+  // コピー禁止
+  Uniform(const Uniform &o) = delete;
+  Uniform &operator=(const Uniform &rhs) = delete;
 
 public:
 
   // コンストラクタ
+  //   manager: バッファオブジェクトを管理するリソースマネージャ
   //   data: uniform ブロックに格納するデータ
-  Uniform(const T *data = NULL)
-    : buffer(new UniformBuffer(data))
+  Uniform(ResourceManager &manager, const T *data = NULL)
+    : manager(manager)
+    , buffer(manager.createBuffer(GL_UNIFORM_BUFFER,
+      sizeof (T), data, GL_STATIC_DRAW))
   {
   }
 
   // デストラクタ
   virtual ~Uniform()
   {
+    // GPU が使い終わってからユニフォームバッファオブジェクトを削除する
+    manager.release(buffer);
   }
 
   // ユニフォームバッファオブジェクトにデータを格納する
   //   data: uniform ブロックに格納するデータ
   void set(const T *data) const
   {
-    glBindBuffer(GL_UNIFORM_BUFFER, buffer->ubo);
+    const Buffer *const b(manager.getBuffer(buffer));
+    if (b == nullptr) return;
+    glBindBuffer(GL_UNIFORM_BUFFER, b->name);
     glBufferSubData(GL_UNIFORM_BUFFER, 0,
       sizeof (T), data);
+    Telemetry::add(Telemetry::UNIFORM_BYTES, sizeof (T));
   }
 
   // このユニフォームバッファオブジェクトを使用する
   //   bp: 結合ポイント
   void select(GLuint bp = 0) const
   {
+    const Buffer *const b(manager.getBuffer(buffer));
+    if (b == nullptr) return;
+
     // 結合ポイントにユニフォームバッファオブジェクトを結合する
     glBindBufferBase(GL_UNIFORM_BUFFER, bp,
-      buffer->ubo);
+      b->name);
+    Telemetry::add(Telemetry::UBO_BINDS);
   }
 };
-
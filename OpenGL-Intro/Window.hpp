@@ -80,6 +80,15 @@ public:
 
 	}
 
+	// GLFWのウィンドウのハンドル（GLコンテキストの共有に使う）
+	GLFWwindow* getHandle() const { return _window; }
+
+	// ウィンドウのタイトルを変える
+	void setTitle(const char* title) { glfwSetWindowTitle(_window, title); }
+
+	// キーが押されているかどうか
+	bool isKeyPressed(int key) const { return glfwGetKey(_window, key) != GLFW_RELEASE; }
+
 	const GLfloat* getSize() const { return _size; }
 	const GLfloat* getLocation() const { return _location; }
 
@@ -1,8 +1,19 @@
 #version 150 core
-in vec3 Idiff;
-in vec3 Ispec;
+const int Lcount = 2;
+uniform sampler2DArrayShadow shadowMap;
+in vec3 Iamb;
+in vec3 Idiff[Lcount];
+in vec3 Ispec[Lcount];
+in vec4 Pshadow[Lcount];
 out vec4 fragment;
 void main()
 {
-	fragment = vec4(Idiff + Ispec, 1.0);
+	vec3 color = Iamb;
+	for (int i = 0; i < Lcount; ++i)
+	{
+		vec3 s = Pshadow[i].xyz / Pshadow[i].w;
+		float lit = Pshadow[i].w > 0.0 ? texture(shadowMap, vec4(s.xy, float(i), s.z)) : 1.0;
+		color += (Idiff[i] + Ispec[i]) * lit;
+	}
+	fragment = vec4(color, 1.0);
 }
\ No newline at end of file
@@ -1,12 +1,16 @@
 #version 150 core
-uniform mat4 modelView;
-uniform mat4 projection;
-uniform mat3 normalMatrix;
+layout (std140) uniform Transform
+{
+  mat4 modelView;
+  mat4 projection;
+  mat3 normalMatrix;
+};
 const int Lcount = 2;
 uniform vec4 Lpos[Lcount];
 uniform vec3 Lamb[Lcount];
 uniform vec3 Ldiff[Lcount];
 uniform vec3 Lspec[Lcount];
+uniform mat4 shadowMatrix[Lcount];
 layout (std140) uniform Material
 {
   vec3 Kamb;
@@ -16,22 +20,24 @@ layout (std140) uniform Material
 };
 in vec4 position;
 in vec3 normal;
-out vec3 Idiff;
-out vec3 Ispec;
+out vec3 Iamb;
+out vec3 Idiff[Lcount];
+out vec3 Ispec[Lcount];
+out vec4 Pshadow[Lcount];
 void main()
 {
   vec4 P = modelView * position;
   vec3 N = normalize(normalMatrix * normal);
   vec3 V = -normalize(P.xyz);
-  Idiff = vec3(0.0);
-  Ispec = vec3(0.0);
+  Iamb = vec3(0.0);
   for (int i = 0; i < Lcount; ++i)
   {
     vec3 L = normalize((Lpos[i] * P.w - P * Lpos[i].w).xyz);
-    vec3 Iamb = Kamb * Lamb[i];
-    Idiff += max(dot(N, L), 0.0) * Kdiff * Ldiff[i] + Iamb;
+    Iamb += Kamb * Lamb[i];
+    Idiff[i] = max(dot(N, L), 0.0) * Kdiff * Ldiff[i];
     vec3 H = normalize(L + V);
-    Ispec += pow(max(dot(N, H), 0.0), Kshi) * Kspec * Lspec[i];
+    Ispec[i] = pow(max(dot(N, H), 0.0), Kshi) * Kspec * Lspec[i];
+    Pshadow[i] = shadowMatrix[i] * P;
   }
   gl_Position = projection * P;
 }
@@ -0,0 +1,7 @@
+#version 150 core
+uniform mat4 lightMatrix;
+in vec4 position;
+void main()
+{
+  gl_Position = lightMatrix * position;
+}
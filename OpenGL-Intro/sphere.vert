@@ -0,0 +1,54 @@
+#version 150 core
+layout (std140) uniform Transform
+{
+  mat4 modelView;
+  mat4 projection;
+  mat3 normalMatrix;
+};
+const int Lcount = 2;
+uniform vec4 Lpos[Lcount];
+uniform vec3 Lamb[Lcount];
+uniform vec3 Ldiff[Lcount];
+uniform vec3 Lspec[Lcount];
+uniform mat4 shadowMatrix[Lcount];
+layout (std140) uniform Material
+{
+  vec3 Kamb;
+  vec3 Kdiff;
+  vec3 Kspec;
+  float Kshi;
+};
+uniform ivec2 tessellation;
+const int Icount = 16;
+uniform vec4 instance[Icount];
+out vec3 Iamb;
+out vec3 Idiff[Lcount];
+out vec3 Ispec[Lcount];
+out vec4 Pshadow[Lcount];
+const float pi = 3.14159265;
+const ivec2 corner[6] = ivec2[](ivec2(0, 0), ivec2(0, 1), ivec2(1, 1), ivec2(0, 0), ivec2(1, 1), ivec2(1, 0));
+void main()
+{
+  int quad = gl_VertexID / 6;
+  ivec2 k = ivec2(quad % tessellation.x, quad / tessellation.x) + corner[gl_VertexID % 6];
+  float t = float(k.y) / float(tessellation.y);
+  float s = float(k.x) / float(tessellation.x);
+  float r = sin(pi * t);
+  vec3 normal = vec3(r * sin(2.0 * pi * s), cos(pi * t), r * cos(2.0 * pi * s));
+  vec4 center = instance[gl_InstanceID];
+  vec4 position = vec4(center.xyz + normal * center.w, 1.0);
+  vec4 P = modelView * position;
+  vec3 N = normalize(normalMatrix * normal);
+  vec3 V = -normalize(P.xyz);
+  Iamb = vec3(0.0);
+  for (int i = 0; i < Lcount; ++i)
+  {
+    vec3 L = normalize((Lpos[i] * P.w - P * Lpos[i].w).xyz);
+    Iamb += Kamb * Lamb[i];
+    Idiff[i] = max(dot(N, L), 0.0) * Kdiff * Ldiff[i];
+    vec3 H = normalize(L + V);
+    Ispec[i] = pow(max(dot(N, H), 0.0), Kshi) * Kspec * Lspec[i];
+    Pshadow[i] = shadowMatrix[i] * P;
+  }
+  gl_Position = projection * P;
+}
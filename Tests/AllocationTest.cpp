@@ -0,0 +1,93 @@
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <gtest/gtest.h>
+#include "AllocationCounter.hpp"
+#include "Allocator.hpp"
+#include "Matrix.hpp"
+#include "TransformStore.hpp"
+
+// 確保したポインタを外に見せて、最適化で new が省かれないようにする
+static void* volatile sink;
+
+// ---------------------------------------------------------------- //
+//	AllocationCounter / AllocationScope
+// ---------------------------------------------------------------- //
+
+// 通常の new と配列の new を数える
+TEST(AllocationCounter, CountsNew)
+{
+	const AllocationScope scope;
+	std::unique_ptr<int> a(new int(1));
+	std::unique_ptr<int[]> b(new int[16]);
+	sink = a.get();
+	sink = b.get();
+	EXPECT_EQ(scope.getCount(), 2u);
+}
+
+// 境界を指定した new（C++17 の align_val_t 付き）も数え、境界を守る
+TEST(AllocationCounter, CountsAlignedNew)
+{
+	struct alignas(64) Block { float v[16]; };
+
+	const AllocationScope scope;
+	std::unique_ptr<Block> a(new Block());
+	std::unique_ptr<Block[]> b(new Block[3]);
+	sink = a.get();
+	sink = b.get();
+	EXPECT_EQ(scope.getCount(), 2u);
+	EXPECT_EQ(reinterpret_cast<std::uintptr_t>(a.get()) % 64, 0u);
+	EXPECT_EQ(reinterpret_cast<std::uintptr_t>(b.get()) % 64, 0u);
+}
+
+// 容量を超えた確保は nullptr になり、reserve() で広げれば確保できる
+TEST(LinearArena, ReserveAfterOverflow)
+{
+	LinearArena arena(64);
+	EXPECT_NE(arena.allocate<GLfloat>(16), nullptr);
+	EXPECT_EQ(arena.allocate<GLfloat>(16), nullptr);
+
+	arena.reserve(arena.getCapacity() * 2);
+	EXPECT_EQ(arena.getUsed(), 0u);
+	EXPECT_NE(arena.allocate<GLfloat>(16), nullptr);
+	EXPECT_NE(arena.allocate<GLfloat>(16), nullptr);
+}
+
+// ---------------------------------------------------------------- //
+//	Steady-state frame
+// ---------------------------------------------------------------- //
+
+// Main のフレームと同じように一時データを確保して捨てる CPU 側の処理
+//   最初のフレームの後はヒープを確保しない
+TEST(AllocationCounter, SteadyStateFrameDoesNotAllocate)
+{
+	struct Item { const void* shape; GLintptr transform; bool occluder; };
+
+	LinearArena frameArena(64 * 1024);
+	Pool<Item> pool(16);
+	TransformStore transforms(5);
+	for (int i = 0; i < 5; ++i) transforms.create();
+	const Matrix view(Matrix::lookat(3.0f, 4.0f, 5.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f));
+
+	for (int frame = 0; frame < 10; ++frame) {
+		const AllocationScope allocations;
+
+		Item* const draws(frameArena.allocate<Item>(2));
+		GLfloat* const modelViews(frameArena.allocate<GLfloat>(16 * transforms.getCount()));
+		GLfloat* const normalMatrices(frameArena.allocate<GLfloat>(12 * transforms.getCount()));
+		ASSERT_NE(draws, nullptr);
+		ASSERT_NE(modelViews, nullptr);
+		ASSERT_NE(normalMatrices, nullptr);
+
+		for (std::uint32_t i = 0; i < transforms.getCount(); ++i) transforms.setAxisAngle(i, 0.1f * frame, 0.0f, 1.0f, 0.0f);
+		transforms.compose(view, modelViews, normalMatrices);
+
+		const std::uint32_t slot(pool.create(Item{ nullptr, 0, false }));
+		pool.destroy(slot);
+		frameArena.reset();
+
+		if (frame > 0) {
+			EXPECT_EQ(allocations.getCount(), 0u) << "frame " << frame;
+		}
+	}
+}
@@ -0,0 +1,126 @@
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include "AllocationCounter.hpp"
+#include "Matrix.hpp"
+#include "MeshGenerator.hpp"
+#include "OcclusionCuller.hpp"
+
+// デプスバッファで遮蔽物が描かれていない画素の数
+static int countEmpty(const OcclusionCuller& culler)
+{
+	const float* const depth(culler.getDepth());
+	int empty(0);
+	for (int i = 0; i < culler.getWidth() * culler.getHeight(); ++i) {
+		if (depth[i] >= 1.0f) ++empty;
+	}
+	return empty;
+}
+
+// ---------------------------------------------------------------- //
+//	Fill rule
+// ---------------------------------------------------------------- //
+
+// 画面を覆う四角形の2つの三角形が共有する対角線の上にも隙間ができない
+TEST(OcclusionCuller, QuadDiagonalIsWatertight)
+{
+	static const Object::Vertex quad[] = {
+		{ { -10.0f, -10.0f, -3.0f }, { 0.0f, 0.0f, 1.0f } },
+		{ {  10.0f, -10.0f, -3.0f }, { 0.0f, 0.0f, 1.0f } },
+		{ {  10.0f,  10.0f, -3.0f }, { 0.0f, 0.0f, 1.0f } },
+		{ { -10.0f,  10.0f, -3.0f }, { 0.0f, 0.0f, 1.0f } }
+	};
+	static const GLuint index[] = { 0, 1, 2, 0, 2, 3 };
+
+	OcclusionCuller culler(256, 128);
+	const Matrix projection(Matrix::perspective(1.0f, 2.0f, 1.0f, 10.0f));
+	culler.clear();
+	culler.addOccluder(projection, 4, quad, 6, index);
+	culler.rasterize();
+	EXPECT_EQ(countEmpty(culler), 0);
+
+	// 四角形の奥にあるボックスは隠れていて、手前にあるボックスは見える
+	static const GLfloat boxMin[] = { -0.5f, -0.5f, -0.5f };
+	static const GLfloat boxMax[] = { 0.5f, 0.5f, 0.5f };
+	EXPECT_FALSE(culler.isVisible(projection * Matrix::translate(0.0f, 0.0f, -6.0f), boxMin, boxMax));
+	EXPECT_TRUE(culler.isVisible(projection * Matrix::translate(0.0f, 0.0f, -2.0f), boxMin, boxMax));
+}
+
+// 画面を覆う四角形を任意の内側の点から扇形に分けても、向きが混ざっていても隙間ができない
+TEST(OcclusionCuller, FanIsWatertight)
+{
+	std::mt19937 random(12345);
+	std::uniform_real_distribution<float> inner(-0.9f, 0.9f);
+
+	OcclusionCuller culler(256, 128);
+	for (int n = 0; n < 100; ++n) {
+		// クリップ座標をそのまま頂点にする（w = 1）
+		const Object::Vertex vertex[] = {
+			{ { inner(random), inner(random), 0.0f }, { 0.0f, 0.0f, 1.0f } },
+			{ { -1.5f, -1.5f, 0.0f }, { 0.0f, 0.0f, 1.0f } },
+			{ {  1.5f, -1.5f, 0.0f }, { 0.0f, 0.0f, 1.0f } },
+			{ {  1.5f,  1.5f, 0.0f }, { 0.0f, 0.0f, 1.0f } },
+			{ { -1.5f,  1.5f, 0.0f }, { 0.0f, 0.0f, 1.0f } }
+		};
+		const GLuint index[] = { 0, 1, 2, 0, 3, 2, 0, 3, 4, 0, 1, 4 };
+
+		culler.clear();
+		culler.addOccluder(Matrix::identity(), 5, vertex, 12, index);
+		culler.rasterize();
+		ASSERT_EQ(countEmpty(culler), 0) << "fan center " << vertex[0].position[0] << ", " << vertex[0].position[1];
+	}
+}
+
+// ---------------------------------------------------------------- //
+//	Threads
+// ---------------------------------------------------------------- //
+
+// タイルをスレッドで分担しても1スレッドと同じデプスバッファになる
+TEST(OcclusionCuller, ThreadedMatchesSingleThread)
+{
+	using Sphere = SphereMesh<32, 16>;
+	const Matrix projection(Matrix::perspective(1.0f, 2.0f, 1.0f, 10.0f));
+
+	OcclusionCuller single(256, 128, 1), threaded(256, 128, 4);
+	for (OcclusionCuller* culler : { &single, &threaded }) {
+		culler->clear();
+		for (int i = 0; i < 5; ++i) {
+			culler->addOccluder(projection * Matrix::translate(-2.0f + i, 0.3f * i - 0.6f, -4.0f - 0.5f * i),
+				Sphere::vertexCount, Sphere::vertex.data(), Sphere::indexCount, Sphere::index.data());
+		}
+		culler->rasterize();
+	}
+
+	const std::vector<float> a(single.getDepth(), single.getDepth() + single.getWidth() * single.getHeight());
+	const std::vector<float> b(threaded.getDepth(), threaded.getDepth() + threaded.getWidth() * threaded.getHeight());
+	EXPECT_EQ(a, b);
+	EXPECT_GT(countEmpty(single), 0);
+	EXPECT_LT(countEmpty(single), single.getWidth() * single.getHeight());
+}
+
+// 常駐スレッドは毎回同じ結果を描き、描画のたびにスレッドを作ったりヒープを確保したりしない
+TEST(OcclusionCuller, ThreadedRasterizeReusesWorkers)
+{
+	using Sphere = SphereMesh<32, 16>;
+	const Matrix projection(Matrix::perspective(1.0f, 2.0f, 1.0f, 10.0f));
+
+	OcclusionCuller single(256, 128, 1), threaded(256, 128, 4);
+	for (int frame = 0; frame < 20; ++frame) {
+		const Matrix model(projection * Matrix::translate(0.1f * (frame % 7) - 0.3f, 0.0f, -4.0f));
+		std::size_t allocations(0);
+		for (OcclusionCuller* culler : { &single, &threaded }) {
+			culler->clear();
+			culler->addOccluder(model, Sphere::vertexCount, Sphere::vertex.data(), Sphere::indexCount, Sphere::index.data());
+
+			// タイルへの振り分けは一覧が育つ間は確保するので、描画だけを数える
+			const AllocationScope scope;
+			culler->rasterize();
+			if (culler == &threaded) allocations = scope.getCount();
+		}
+
+		const std::vector<float> a(single.getDepth(), single.getDepth() + single.getWidth() * single.getHeight());
+		const std::vector<float> b(threaded.getDepth(), threaded.getDepth() + threaded.getWidth() * threaded.getHeight());
+		ASSERT_EQ(a, b) << "frame " << frame;
+		EXPECT_EQ(allocations, 0u) << "frame " << frame;
+	}
+}
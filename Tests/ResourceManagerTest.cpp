@@ -0,0 +1,141 @@
+#include <cstdint>
+#include <vector>
+#include <gtest/gtest.h>
+#include "ResourceManager.hpp"
+
+// 生きている数を数えるオブジェクト
+struct Counted {
+	static int alive;
+	int value;
+
+	Counted(int value)
+		: value(value)
+	{
+		++alive;
+	}
+
+	~Counted() { --alive; }
+
+	Counted(const Counted& o) = delete;
+	Counted& operator=(const Counted& rhs) = delete;
+};
+
+int Counted::alive(0);
+
+// ---------------------------------------------------------------- //
+//	Generation
+// ---------------------------------------------------------------- //
+
+// 同じスロットに作り直すと世代が進み、古いハンドルはもう引けない
+TEST(SlotTable, StaleHandleDoesNotResolveAfterReuse)
+{
+	SlotTable<Counted> table(4);
+
+	const Handle<Counted> first(table.create(16, 1));
+	ASSERT_FALSE(first.isNull());
+	ASSERT_NE(table.get(first), nullptr);
+	EXPECT_EQ(table.get(first)->value, 1);
+
+	// 無効にした時点で引けなくなる（スロットはまだ再利用されない）
+	EXPECT_TRUE(table.retire(first));
+	EXPECT_EQ(table.get(first), nullptr);
+	EXPECT_FALSE(table.retire(first));
+	table.destroy(first.index());
+
+	const Handle<Counted> second(table.create(32, 2));
+	ASSERT_FALSE(second.isNull());
+	EXPECT_EQ(second.index(), first.index());
+	EXPECT_EQ(second.generation(), first.generation() + 1);
+	EXPECT_NE(second, first);
+
+	EXPECT_EQ(table.get(first), nullptr);
+	ASSERT_NE(table.get(second), nullptr);
+	EXPECT_EQ(table.get(second)->value, 2);
+	EXPECT_EQ(table.getBytes(second.index()), 32u);
+}
+
+// 世代は 16 ビットで一周しても 0（無効なハンドル）にならず、直前の世代のハンドルは引けない
+TEST(SlotTable, GenerationWrapsAroundSkippingZero)
+{
+	SlotTable<Counted> table(1);
+
+	Handle<Counted> h(table.create(0, 0));
+	ASSERT_EQ(h.generation(), 1u);
+	for (std::uint32_t i = 1; i < 0xffff; ++i) {
+		ASSERT_TRUE(table.retire(h));
+		table.destroy(h.index());
+		h = table.create(0, 0);
+	}
+	ASSERT_EQ(h.generation(), 0xffffu);
+	EXPECT_EQ(h.value() >> 16, 0xffffu);
+
+	const Handle<Counted> last(h);
+	ASSERT_TRUE(table.retire(h));
+	table.destroy(h.index());
+	h = table.create(0, 0);
+
+	EXPECT_FALSE(h.isNull());
+	EXPECT_EQ(h.generation(), 1u);
+	EXPECT_EQ(table.get(last), nullptr);
+	EXPECT_NE(table.get(h), nullptr);
+}
+
+// ---------------------------------------------------------------- //
+//	Churn
+// ---------------------------------------------------------------- //
+
+// 作成・無効化・破棄を繰り返してもスロットもオブジェクトも残らない
+TEST(SlotTable, ChurnReturnsEverySlot)
+{
+	static constexpr std::uint32_t capacity(256);
+	SlotTable<Counted> table(capacity);
+	std::vector<Handle<Counted>> live, retired;
+
+	for (int round = 0; round < 1000; ++round) {
+		// 毎回違う数を作る
+		const int count(1 + round % 64);
+		for (int i = 0; i < count; ++i) {
+			const Handle<Counted> h(table.create(8, i));
+			ASSERT_FALSE(h.isNull()) << "round " << round;
+			live.push_back(h);
+		}
+
+		// 半分を無効にし、前の回に無効にしたものを破棄する（collect() と同じく1回遅れで破棄する）
+		for (const Handle<Counted> h : retired) table.destroy(h.index());
+		retired.clear();
+		for (std::size_t i = 0; i < live.size(); i += 2) {
+			ASSERT_TRUE(table.retire(live[i]));
+			retired.push_back(live[i]);
+		}
+		std::vector<Handle<Counted>> kept;
+		for (std::size_t i = 1; i < live.size(); i += 2) kept.push_back(live[i]);
+		live.swap(kept);
+
+		// 残りを全部無効にして、表をいったん空にする
+		if (round % 10 == 9) {
+			for (const Handle<Counted> h : live) {
+				ASSERT_TRUE(table.retire(h));
+				retired.push_back(h);
+			}
+			live.clear();
+		}
+
+		// 無効にしたハンドルはどれも引けない
+		for (const Handle<Counted> h : retired) ASSERT_EQ(table.get(h), nullptr);
+		for (const Handle<Counted> h : live) ASSERT_NE(table.get(h), nullptr);
+	}
+
+	for (const Handle<Counted> h : retired) table.destroy(h.index());
+	for (const Handle<Counted> h : live) {
+		table.retire(h);
+		table.destroy(h.index());
+	}
+
+	EXPECT_EQ(table.getCount(), 0u);
+	EXPECT_EQ(Counted::alive, 0);
+
+	// 空きスロットの一覧も元の大きさに戻り、容量いっぱいまで作れる
+	for (std::uint32_t i = 0; i < capacity; ++i) ASSERT_FALSE(table.create(0, 0).isNull());
+	EXPECT_TRUE(table.create(0, 0).isNull());
+	EXPECT_EQ(table.getCount(), capacity);
+}
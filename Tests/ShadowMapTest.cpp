@@ -0,0 +1,147 @@
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <gtest/gtest.h>
+#include "HeadlessContext.hpp"
+#include "ShadowMap.hpp"
+
+// shadow.vert と shadow.frag からプログラムオブジェクトを作る
+static GLuint loadShadowProgram()
+{
+	const char* const names[] = { SHADER_DIR "/shadow.vert", SHADER_DIR "/shadow.frag" };
+	const GLenum types[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+
+	const GLuint program(glCreateProgram());
+	for (int i = 0; i < 2; ++i) {
+		std::ifstream file(names[i], std::ios::binary);
+		const std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		const GLchar* const src(source.c_str());
+
+		const GLuint shader(glCreateShader(types[i]));
+		glShaderSource(shader, 1, &src, nullptr);
+		glCompileShader(shader);
+		glAttachShader(program, shader);
+		glDeleteShader(shader);
+	}
+	glBindAttribLocation(program, 0, "position");
+	glLinkProgram(program);
+
+	GLint status;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	return status == GL_FALSE ? 0 : program;
+}
+
+// デプスマップ全体を覆う三角形を描く
+class Cover {
+	GLuint _vao, _vbo;
+
+public:
+	Cover() {
+		static constexpr GLfloat position[] = { -1.0f, -1.0f, 3.0f, -1.0f, -1.0f, 3.0f };
+		glGenVertexArrays(1, &_vao);
+		glBindVertexArray(_vao);
+		glGenBuffers(1, &_vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+		glBufferData(GL_ARRAY_BUFFER, sizeof position, position, GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+		glEnableVertexAttribArray(0);
+		glBindVertexArray(0);
+	}
+
+	~Cover() {
+		glDeleteBuffers(1, &_vbo);
+		glDeleteVertexArrays(1, &_vao);
+	}
+
+	// z: クリップ座標系の奥行き（-1〜1）
+	void draw(const ShadowMap& shadow, GLfloat z) const {
+		const Matrix m(Matrix::translate(0.0f, 0.0f, z));
+		shadow.cast(m);
+		glBindVertexArray(_vao);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		glBindVertexArray(0);
+	}
+};
+
+// 描画用のレイヤ layer の中央のデプス
+static GLfloat readDepth(const ShadowMap& shadow, GLint layer, GLsizei size)
+{
+	GLint texture;
+	shadow.bind(0);
+	glActiveTexture(GL_TEXTURE0);
+	glGetIntegerv(GL_TEXTURE_BINDING_2D_ARRAY, &texture);
+
+	GLuint fbo;
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+	glReadBuffer(GL_NONE);
+	glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, static_cast<GLuint>(texture), 0, layer);
+	GLfloat depth(0.0f);
+	glReadPixels(size / 2, size / 2, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &depth);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &fbo);
+	return depth;
+}
+
+// ---------------------------------------------------------------- //
+//	Static cache
+// ---------------------------------------------------------------- //
+
+// 動的な物体がないフレームはキャッシュを複製するだけで、続くフレームは何も描かない
+// invalidate() すると静的な物体を描き直す
+TEST(ShadowMap, SkipsUnchangedFramesAndRedrawsAfterInvalidate)
+{
+	HeadlessContext context(16, 16);
+	if (!context.isValid()) GTEST_SKIP() << "No headless GL context";
+
+	const GLuint program(loadShadowProgram());
+	ASSERT_NE(program, 0u);
+
+	static constexpr int lights(2);
+	static constexpr GLsizei size(64);
+	static constexpr GLfloat target[] = { 0.0f, 0.0f, 0.0f };
+	static constexpr GLfloat position[] = { 0.0f, 0.0f, 5.0f };
+	ShadowMap shadow(program, lights, size);
+	for (int i = 0; i < lights; ++i) shadow.setLight(i, position, target);
+	glEnable(GL_DEPTH_TEST);
+	const Cover cover;
+
+	// 静的な物体は奥（デプス 0.5）、動的な物体は手前（デプス 0.25）に描く
+	int staticDraws(0), dynamicDraws(0);
+	const auto frame([&](bool dynamic) {
+		staticDraws = dynamicDraws = 0;
+		Telemetry::current = Telemetry::Frame{};
+		shadow.render(
+			[&](int) { ++staticDraws; cover.draw(shadow, 0.0f); },
+			[&](int) { ++dynamicDraws; cover.draw(shadow, -0.5f); },
+			dynamic);
+		return Telemetry::current.counter[Telemetry::SHADOW_PASSES];
+	});
+
+	// 最初のフレームはキャッシュを描いて、複製に動的な物体を重ねる
+	EXPECT_EQ(frame(true), 2u * lights);
+	EXPECT_EQ(staticDraws, lights);
+	EXPECT_EQ(dynamicDraws, lights);
+	EXPECT_NEAR(readDepth(shadow, 0, size), 0.25f, 0.01f);
+
+	// 動的な物体がなくなったフレームはキャッシュを複製し直す
+	EXPECT_EQ(frame(false), static_cast<std::uint64_t>(lights));
+	EXPECT_EQ(staticDraws, 0);
+	EXPECT_EQ(dynamicDraws, 0);
+	EXPECT_NEAR(readDepth(shadow, 0, size), 0.5f, 0.01f);
+
+	// 何も変わらなければ描かない
+	EXPECT_EQ(frame(false), 0u);
+	EXPECT_EQ(shadow.getStaticUpdates(), static_cast<unsigned long long>(lights));
+
+	// 静的な物体が変わったらキャッシュと描画用のレイヤを描き直す
+	shadow.invalidate();
+	EXPECT_EQ(frame(false), 2u * lights);
+	EXPECT_EQ(staticDraws, lights);
+	EXPECT_EQ(dynamicDraws, 0);
+	EXPECT_EQ(shadow.getStaticUpdates(), 2ull * lights);
+	EXPECT_EQ(frame(false), 0u);
+
+	EXPECT_EQ(glGetError(), static_cast<GLenum>(GL_NO_ERROR));
+	glDeleteProgram(program);
+}
@@ -0,0 +1,47 @@
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <gtest/gtest.h>
+#include "Matrix.hpp"
+#include "TransformStore.hpp"
+
+// インスタンスごとに違う変換を設定した TransformStore
+static void fill(TransformStore& store, std::uint32_t count)
+{
+	for (std::uint32_t i = 0; i < count; ++i) {
+		const std::uint32_t k(store.create());
+		store.setPosition(k, static_cast<GLfloat>(i % 97), static_cast<GLfloat>(i % 13), static_cast<GLfloat>(i % 31));
+		store.setAxisAngle(k, 0.01f * i, 0.0f, 1.0f, 0.0f);
+		store.setScale(k, 1.0f + 0.001f * i, 1.0f, 1.0f);
+	}
+}
+
+// ---------------------------------------------------------------- //
+//	Threaded compose
+// ---------------------------------------------------------------- //
+
+// スレッドで分担しても、4 * threads の倍数でない数の最後のインスタンスまで1スレッドと同じ結果になる
+TEST(TransformStore, ThreadedMatchesSingleThread)
+{
+	const Matrix view(Matrix::lookat(3.0f, 4.0f, 5.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f));
+
+	for (const std::uint32_t count : { 1024u, 1025u, 1027u, 1031u, 4099u, 65537u }) {
+		for (const int threads : { 2, 3, 4, 7 }) {
+			TransformStore store(count);
+			fill(store, count);
+
+			// 書き込まれなかった要素がわかるように、分担する方は NaN で埋めておく
+			std::vector<GLfloat> model1(static_cast<std::size_t>(count) * 16), normal1(static_cast<std::size_t>(count) * 12);
+			std::vector<GLfloat> modelN(model1.size(), NAN), normalN(normal1.size(), NAN);
+			store.compose(view, model1.data(), normal1.data(), 1);
+			store.compose(view, modelN.data(), normalN.data(), threads);
+
+			for (std::size_t i = 0; i < model1.size(); ++i) {
+				ASSERT_EQ(model1[i], modelN[i]) << "count " << count << ", threads " << threads << ", instance " << i / 16;
+			}
+			for (std::size_t i = 0; i < normal1.size(); ++i) {
+				ASSERT_EQ(normal1[i], normalN[i]) << "count " << count << ", threads " << threads << ", instance " << i / 12;
+			}
+		}
+	}
+}